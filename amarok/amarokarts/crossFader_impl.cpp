@@ -0,0 +1,199 @@
+/***************************************************************************
+                          crossFader_impl.cpp  -  description
+                             -------------------
+    begin                : Mon Mai 12 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "crossFader_impl.h"
+
+#include <math.h>
+#include <string.h>
+
+using namespace Arts;
+
+
+CrossFader_impl::CrossFader_impl() :
+m_duration( 5.0 ),
+m_curve( Amarok::fadeEqualPower ),
+m_from( 0 ),
+m_fading( false ),
+m_position( 0.0 )
+{
+    m_inputGain[0] = 1.0;
+    m_inputGain[1] = 1.0;
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+float CrossFader_impl::duration()
+{
+    return m_duration;
+}
+
+
+
+void CrossFader_impl::duration( float newValue )
+{
+    m_duration = newValue;
+}
+
+
+
+Amarok::FadeCurve CrossFader_impl::curve()
+{
+    return m_curve;
+}
+
+
+
+void CrossFader_impl::curve( Amarok::FadeCurve newValue )
+{
+    m_curve = newValue;
+}
+
+
+
+long CrossFader_impl::active()
+{
+    return m_fading ? 1 - m_from : m_from;
+}
+
+
+
+bool CrossFader_impl::fading()
+{
+    return m_fading;
+}
+
+
+
+void CrossFader_impl::fade()
+{
+// fading back while still fading starts from where we are, so there's no jump
+    if ( m_fading )
+    {
+        m_from = 1 - m_from;
+        m_position = 1.0 - m_position;
+    }
+    else
+    {
+        m_fading = true;
+        m_position = 0.0;
+    }
+}
+
+
+
+void CrossFader_impl::stopFade()
+{
+    if ( m_fading )
+    {
+        m_from = 1 - m_from;
+        m_fading = false;
+    }
+}
+
+
+
+void CrossFader_impl::setGain( long input, float factor )
+{
+    if ( input == 0 || input == 1 )
+        m_inputGain[input] = factor;
+}
+
+
+
+float CrossFader_impl::gain( float x ) const
+{
+    switch ( m_curve )
+    {
+        case Amarok::fadeLinear:
+            return x;
+
+// constant power, so the middle of the fade isn't quieter than the ends
+        case Amarok::fadeEqualPower:
+            return sin( x * M_PI / 2.0 );
+
+        case Amarok::fadeSCurve:
+        default:
+            return 0.5 - 0.5 * cos( x * M_PI );
+    }
+}
+
+
+
+void CrossFader_impl::calculateBlock( unsigned long samples )
+{
+    float *fromLeft = m_from == 0 ? inleft : inleft2;
+    float *fromRight = m_from == 0 ? inright : inright2;
+
+    const float fromScale = m_inputGain[m_from];
+    const float toScale = m_inputGain[1 - m_from];
+
+    if ( !m_fading )
+    {
+        if ( fromScale == 1.0 )
+        {
+            memcpy( outleft, fromLeft, samples * sizeof( float ) );
+            memcpy( outright, fromRight, samples * sizeof( float ) );
+            return;
+        }
+
+        for ( unsigned long i = 0; i < samples; ++i )
+        {
+            outleft[i] = fromScale * fromLeft[i];
+            outright[i] = fromScale * fromRight[i];
+        }
+
+        return;
+    }
+
+    float *toLeft = m_from == 0 ? inleft2 : inleft;
+    float *toRight = m_from == 0 ? inright2 : inright;
+
+    float end = 1.0;
+
+    if ( m_duration > 0.0 )
+        end = m_position + samples / ( m_duration * samplingRateFloat );
+    if ( end > 1.0 )
+        end = 1.0;
+
+// the curve is evaluated once per block, in between the gains are ramped linearly
+    float fromGain = fromScale * gain( 1.0 - m_position );
+    float toGain = toScale * gain( m_position );
+    const float fromStep = ( fromScale * gain( 1.0 - end ) - fromGain ) / samples;
+    const float toStep = ( toScale * gain( end ) - toGain ) / samples;
+
+    for ( unsigned long i = 0; i < samples; ++i )
+    {
+        outleft[i] = fromGain * fromLeft[i] + toGain * toLeft[i];
+        outright[i] = fromGain * fromRight[i] + toGain * toRight[i];
+
+        fromGain += fromStep;
+        toGain += toStep;
+    }
+
+    m_position = end;
+
+    if ( m_position >= 1.0 )
+    {
+        m_from = 1 - m_from;
+        m_fading = false;
+    }
+}
+
+
+REGISTER_IMPLEMENTATION( CrossFader_impl );
@@ -0,0 +1,60 @@
+/***************************************************************************
+                          crossFader_impl.h  -  description
+                             -------------------
+    begin                : Mon Mai 12 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef CROSSFADER_IMPL_H
+#define CROSSFADER_IMPL_H
+
+#include "amarokarts.h"
+
+#include <stdsynthmodule.h>
+
+/**
+ * Server side of Amarok::CrossFader. The fade runs entirely in
+ * calculateBlock(), the client only says when it starts.
+ *@author mark
+ */
+
+class CrossFader_impl : virtual public Amarok::CrossFader_skel, virtual public Arts::StdSynthModule
+{
+    public:
+        CrossFader_impl();
+
+        float duration();
+        void duration( float newValue );
+        Amarok::FadeCurve curve();
+        void curve( Amarok::FadeCurve newValue );
+        long active();
+        bool fading();
+
+        void fade();
+        void stopFade();
+        void setGain( long input, float factor );
+
+        void calculateBlock( unsigned long samples );
+
+    private:
+        float gain( float x ) const;
+
+// ATTRIBUTES ------
+        float m_duration;               // seconds
+        Amarok::FadeCurve m_curve;
+        long m_from;                    // input heard when not fading, faded out when fading
+        bool m_fading;
+        float m_position;               // 0 .. 1 through the fade
+        float m_inputGain[2];
+};
+#endif
@@ -0,0 +1,298 @@
+/***************************************************************************
+                          loudnessMeter_impl.cpp  -  description
+                             -------------------
+    begin                : Sam Mai 17 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "loudnessMeter_impl.h"
+
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+
+using namespace Arts;
+
+// seconds between two looks at the PlayObject, like the PlaybackMonitor
+static const float CHECK_INTERVAL = 0.01;
+// the reference analysis works on 50 ms windows
+static const float WINDOW_TIME = 0.05;
+static const float HIGHPASS_FREQUENCY = 150.0;
+// histogram resolution and range, for levels of 16 bit samples
+static const int STEPS_PER_DB = 100;
+static const int MAX_DB = 120;
+// level of the reference pink noise, the gain brings a track there
+static const float PINK_REF = 64.82;
+// the level 95% of the windows stay below counts, quiet passages don't make a track sound louder
+static const float PERCENTILE = 0.95;
+
+
+// sum of squares with four independent accumulators, so the additions don't wait for each other
+static inline double sumOfSquares( const float *data, unsigned long samples )
+{
+    float s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    unsigned long i = 0;
+
+    for ( ; i + 4 <= samples; i += 4 )
+    {
+        s0 += data[i] * data[i];
+        s1 += data[i + 1] * data[i + 1];
+        s2 += data[i + 2] * data[i + 2];
+        s3 += data[i + 3] * data[i + 3];
+    }
+
+    for ( ; i < samples; ++i )
+        s0 += data[i] * data[i];
+
+    return static_cast<double>( s0 + s1 ) + static_cast<double>( s2 + s3 );
+}
+
+
+
+static inline float peakOf( const float *data, unsigned long samples, float peak )
+{
+    float p0 = peak, p1 = 0.0, p2 = 0.0, p3 = 0.0;
+    unsigned long i = 0;
+
+    for ( ; i + 4 <= samples; i += 4 )
+    {
+        const float a0 = fabsf( data[i] ), a1 = fabsf( data[i + 1] );
+        const float a2 = fabsf( data[i + 2] ), a3 = fabsf( data[i + 3] );
+
+        p0 = a0 > p0 ? a0 : p0;
+        p1 = a1 > p1 ? a1 : p1;
+        p2 = a2 > p2 ? a2 : p2;
+        p3 = a3 > p3 ? a3 : p3;
+    }
+
+    for ( ; i < samples; ++i )
+    {
+        const float a = fabsf( data[i] );
+        p0 = a > p0 ? a : p0;
+    }
+
+    p0 = p1 > p0 ? p1 : p0;
+    p2 = p3 > p2 ? p3 : p2;
+
+    return p2 > p0 ? p2 : p0;
+}
+
+
+
+LoudnessMeter_impl::LoudnessMeter_impl() :
+m_playObject( PlayObject::null() ),
+m_countdown( 0 ),
+m_playing( false ),
+m_b0( 1.0 ), m_b1( 0.0 ), m_b2( 0.0 ), m_a1( 0.0 ), m_a2( 0.0 ),
+m_windowLength( 2205 ),
+m_histogram( STEPS_PER_DB * MAX_DB )
+{
+    reset();
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void LoudnessMeter_impl::streamInit()
+{
+// second order Butterworth, by bilinear transform for the server's sampling rate
+    const float k = tan( M_PI * HIGHPASS_FREQUENCY / samplingRateFloat );
+    const float norm = 1.0 / ( 1.0 + M_SQRT2 * k + k * k );
+
+    m_b0 = norm;
+    m_b1 = -2.0 * norm;
+    m_b2 = norm;
+    m_a1 = 2.0 * ( k * k - 1.0 ) * norm;
+    m_a2 = ( 1.0 - M_SQRT2 * k + k * k ) * norm;
+
+    m_windowLength = static_cast<unsigned long>( samplingRateFloat * WINDOW_TIME );
+    reset();
+}
+
+
+
+Amarok::Loudness LoudnessMeter_impl::measure( PlayObject playObject )
+{
+    const Amarok::Loudness loudness = result();
+
+    m_playObject = playObject;
+    m_countdown = 0;
+    m_playing = false;
+    reset();
+
+    return loudness;
+}
+
+
+
+void LoudnessMeter_impl::calculateBlock( unsigned long samples )
+{
+    memcpy( outleft, inleft, samples * sizeof( float ) );
+    memcpy( outright, inright, samples * sizeof( float ) );
+
+    if ( m_playObject.isNull() )
+        return;
+
+    m_countdown -= samples;
+
+// paused or still starting up, the silence isn't part of the track
+    if ( m_countdown <= 0 )
+    {
+        m_countdown += static_cast<long>( samplingRateFloat * CHECK_INTERVAL );
+        m_playing = m_playObject.state() == posPlaying;
+    }
+
+    if ( !m_playing )
+        return;
+
+    struct timeval start, end;
+    gettimeofday( &start, 0 );
+
+    analyze( inleft, inright, samples );
+
+    gettimeofday( &end, 0 );
+    m_cpuSeconds += ( end.tv_sec - start.tv_sec ) + ( end.tv_usec - start.tv_usec ) / 1000000.0;
+}
+
+
+
+void LoudnessMeter_impl::analyze( float *left, float *right, unsigned long samples )
+{
+    if ( m_filtered.size() < samples )
+        m_filtered.resize( samples );
+
+    m_peak = peakOf( left, samples, m_peak );
+    m_peak = peakOf( right, samples, m_peak );
+    m_samples += samples;
+
+    unsigned long done = 0;
+
+    while ( done < samples )
+    {
+        const unsigned long windowLeft = m_windowLength - m_windowFill;
+        const unsigned long chunk = samples - done < windowLeft ? samples - done : windowLeft;
+
+        filter( left + done, &m_filtered[0], chunk, m_stateLeft );
+        m_windowSum += sumOfSquares( &m_filtered[0], chunk );
+        filter( right + done, &m_filtered[0], chunk, m_stateRight );
+        m_windowSum += sumOfSquares( &m_filtered[0], chunk );
+
+        done += chunk;
+        m_windowFill += chunk;
+
+        if ( m_windowFill < m_windowLength )
+            continue;
+
+// the reference scales to 16 bit samples, our levels must match its PINK_REF
+        const double meanSquare = m_windowSum / ( 2.0 * m_windowLength ) * 32768.0 * 32768.0;
+        long step = static_cast<long>( STEPS_PER_DB * 10.0 * log10( meanSquare + 1e-37 ) );
+
+        if ( step < 0 )
+            step = 0;
+        if ( step >= static_cast<long>( m_histogram.size() ) )
+            step = m_histogram.size() - 1;
+
+        ++m_histogram[step];
+        m_windowSum = 0.0;
+        m_windowFill = 0;
+    }
+}
+
+
+
+void LoudnessMeter_impl::filter( const float *in, float *out, unsigned long samples, float *state )
+{
+    float x1 = state[0], x2 = state[1], y1 = state[2], y2 = state[3];
+
+    for ( unsigned long i = 0; i < samples; ++i )
+    {
+        const float x = in[i];
+        const float y = m_b0 * x + m_b1 * x1 + m_b2 * x2 - m_a1 * y1 - m_a2 * y2;
+
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        out[i] = y;
+    }
+
+// denormals would slow everything down in long silences
+    if ( fabsf( y1 ) < 1e-20 )
+        y1 = 0.0;
+    if ( fabsf( y2 ) < 1e-20 )
+        y2 = 0.0;
+
+    state[0] = x1;
+    state[1] = x2;
+    state[2] = y1;
+    state[3] = y2;
+}
+
+
+
+Amarok::Loudness LoudnessMeter_impl::result() const
+{
+    Amarok::Loudness loudness;
+    loudness.gain = 0.0;
+    loudness.peak = m_peak;
+    loudness.seconds = m_samples / samplingRateFloat;
+    loudness.cpuSeconds = m_cpuSeconds;
+
+    unsigned long windows = 0;
+
+    for ( unsigned long i = 0; i < m_histogram.size(); ++i )
+        windows += m_histogram[i];
+
+    if ( windows == 0 )
+        return loudness;
+
+    long upper = static_cast<long>( ceil( windows * ( 1.0 - PERCENTILE ) ) );
+    long step = m_histogram.size();
+
+    while ( step-- > 0 )
+    {
+        upper -= m_histogram[step];
+
+        if ( upper <= 0 )
+            break;
+    }
+
+    if ( step < 0 )
+        step = 0;
+
+    loudness.gain = PINK_REF - static_cast<float>( step ) / STEPS_PER_DB;
+
+    return loudness;
+}
+
+
+
+void LoudnessMeter_impl::reset()
+{
+    memset( m_stateLeft, 0, sizeof( m_stateLeft ) );
+    memset( m_stateRight, 0, sizeof( m_stateRight ) );
+
+    m_windowFill = 0;
+    m_windowSum = 0.0;
+
+    for ( unsigned long i = 0; i < m_histogram.size(); ++i )
+        m_histogram[i] = 0;
+
+    m_samples = 0;
+    m_peak = 0.0;
+    m_cpuSeconds = 0.0;
+}
+
+
+REGISTER_IMPLEMENTATION( LoudnessMeter_impl );
@@ -0,0 +1,72 @@
+/***************************************************************************
+                          loudnessMeter_impl.h  -  description
+                             -------------------
+    begin                : Sam Mai 17 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef LOUDNESSMETER_IMPL_H
+#define LOUDNESSMETER_IMPL_H
+
+#include "amarokarts.h"
+
+#include <kmedia2.h>
+#include <stdsynthmodule.h>
+
+#include <vector>
+
+/**
+ * Server side of Amarok::LoudnessMeter. Works like the ReplayGain reference
+ * analysis: the signal is high-passed, the mean square of every 50 ms goes
+ * into a histogram, and the level 95% of the windows stay below decides the
+ * gain. The equal-loudness filter of the reference is left out, so the gains
+ * differ from other ReplayGain tools by a little, but not from each other.
+ *@author mark
+ */
+
+class LoudnessMeter_impl : virtual public Amarok::LoudnessMeter_skel, virtual public Arts::StdSynthModule
+{
+    public:
+        LoudnessMeter_impl();
+
+        Amarok::Loudness measure( Arts::PlayObject playObject );
+
+        void streamInit();
+        void calculateBlock( unsigned long samples );
+
+    private:
+        void analyze( float *left, float *right, unsigned long samples );
+        void filter( const float *in, float *out, unsigned long samples, float *state );
+        Amarok::Loudness result() const;
+        void reset();
+
+// ATTRIBUTES ------
+        Arts::PlayObject m_playObject;
+        long m_countdown;               // samples until the next look at the PlayObject
+        bool m_playing;
+
+        float m_b0, m_b1, m_b2, m_a1, m_a2;
+        float m_stateLeft[4];           // x1, x2, y1, y2 of the high-pass
+        float m_stateRight[4];
+        std::vector<float> m_filtered;
+
+        unsigned long m_windowLength;   // samples
+        unsigned long m_windowFill;
+        double m_windowSum;
+
+        std::vector<unsigned long> m_histogram;
+        unsigned long m_samples;
+        float m_peak;
+        double m_cpuSeconds;
+};
+#endif
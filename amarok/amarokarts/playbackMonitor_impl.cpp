@@ -0,0 +1,120 @@
+/***************************************************************************
+                          playbackMonitor_impl.cpp  -  description
+                             -------------------
+    begin                : Die Mai 13 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "playbackMonitor_impl.h"
+
+#include <string.h>
+
+using namespace Arts;
+
+// seconds between two looks at the PlayObject, that's how late an end is noticed at most
+static const float CHECK_INTERVAL = 0.01;
+
+
+PlaybackMonitor_impl::PlaybackMonitor_impl() :
+m_playObject( PlayObject::null() ),
+m_serial( 0 ),
+m_countdown( 0 ),
+m_state( posIdle ),
+m_second( -1 ),
+m_position( 0.0 ),
+m_length( 0.0 ),
+m_ended( -1.0 )
+{
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void PlaybackMonitor_impl::watch( PlayObject playObject, long serial )
+{
+    m_playObject = playObject;
+    m_serial = serial;
+    m_countdown = 0;
+
+// reported once, so the client knows which object the following changes belong to
+    m_state = m_playObject.isNull() ? posIdle : m_playObject.state();
+    _emit_changed( "state_changed", m_state );
+
+    m_second = -1;
+    m_length = 0.0;
+}
+
+
+
+void PlaybackMonitor_impl::calculateBlock( unsigned long samples )
+{
+    memcpy( outleft, inleft, samples * sizeof( float ) );
+    memcpy( outright, inright, samples * sizeof( float ) );
+
+    m_countdown -= samples;
+
+    if ( m_countdown > 0 )
+        return;
+
+    m_countdown += static_cast<long>( samplingRateFloat * CHECK_INTERVAL );
+    check();
+}
+
+
+
+void PlaybackMonitor_impl::check()
+{
+    if ( m_playObject.isNull() )
+        return;
+
+    const float state = m_playObject.state();
+
+    if ( state != m_state )
+    {
+        if ( m_state == posPlaying && state == posIdle )
+        {
+            m_ended = m_serial;
+            _emit_changed( "ended_changed", m_ended );
+        }
+
+        m_state = state;
+        _emit_changed( "state_changed", m_state );
+    }
+
+    if ( m_state != posPlaying )
+        return;
+
+    const poTime time = m_playObject.currentTime();
+
+// a seek changes the second as well, so it is reported right away
+    if ( time.seconds == m_second )
+        return;
+
+    m_second = time.seconds;
+    m_position = time.seconds + time.ms / 1000.0;
+    _emit_changed( "position_changed", m_position );
+
+// the length of VBR files is only estimated at first, so it's looked at again every second
+    const poTime total = m_playObject.overallTime();
+    const float length = total.seconds + total.ms / 1000.0;
+
+    if ( length != m_length )
+    {
+        m_length = length;
+        _emit_changed( "length_changed", m_length );
+    }
+}
+
+
+REGISTER_IMPLEMENTATION( PlaybackMonitor_impl );
@@ -0,0 +1,61 @@
+/***************************************************************************
+                          playbackMonitor_impl.h  -  description
+                             -------------------
+    begin                : Die Mai 13 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PLAYBACKMONITOR_IMPL_H
+#define PLAYBACKMONITOR_IMPL_H
+
+#include "amarokarts.h"
+
+#include <kmedia2.h>
+#include <stdsynthmodule.h>
+
+/**
+ * Server side of Amarok::PlaybackMonitor. The PlayObject lives in the same
+ * process, so asking it every few ms costs nothing, unlike a round trip
+ * from the client.
+ *@author mark
+ */
+
+class PlaybackMonitor_impl : virtual public Amarok::PlaybackMonitor_skel, virtual public Arts::StdSynthModule
+{
+    public:
+        PlaybackMonitor_impl();
+
+        float state() { return m_state; }
+        float position() { return m_position; }
+        float length() { return m_length; }
+        float ended() { return m_ended; }
+
+        void watch( Arts::PlayObject playObject, long serial );
+
+        void calculateBlock( unsigned long samples );
+
+    private:
+        void check();
+
+// ATTRIBUTES ------
+        Arts::PlayObject m_playObject;
+        long m_serial;
+        long m_countdown;               // samples until the next check
+
+        float m_state;
+        long m_second;                  // of the last reported position
+        float m_position;
+        float m_length;
+        float m_ended;
+};
+#endif
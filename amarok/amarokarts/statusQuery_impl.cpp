@@ -0,0 +1,44 @@
+/***************************************************************************
+                          statusQuery_impl.cpp  -  description
+                             -------------------
+    begin                : Mit Mai 14 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "statusQuery_impl.h"
+
+using namespace Arts;
+
+
+// METHODS -------------------------------------------------------
+
+Amarok::PlaybackStatus StatusQuery_impl::status( PlayObject playObject )
+{
+    Amarok::PlaybackStatus status;
+
+    status.state = posIdle;
+    status.stream = false;
+    status.bufferFill = -1.0;
+
+    if ( playObject.isNull() )
+        return status;
+
+    status.state = playObject.state();
+    status.currentTime = playObject.currentTime();
+    status.overallTime = playObject.overallTime();
+
+    return status;
+}
+
+
+REGISTER_IMPLEMENTATION( StatusQuery_impl );
@@ -0,0 +1,36 @@
+/***************************************************************************
+                          statusQuery_impl.h  -  description
+                             -------------------
+    begin                : Mit Mai 14 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef STATUSQUERY_IMPL_H
+#define STATUSQUERY_IMPL_H
+
+#include "amarokarts.h"
+
+#include <kmedia2.h>
+
+/**
+ * Server side of Amarok::StatusQuery. The calls on the PlayObject are local
+ * to artsd, only the filled in PlaybackStatus goes over the wire.
+ *@author mark
+ */
+
+class StatusQuery_impl : virtual public Amarok::StatusQuery_skel
+{
+    public:
+        Amarok::PlaybackStatus status( Arts::PlayObject playObject );
+};
+#endif
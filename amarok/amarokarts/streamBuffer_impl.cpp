@@ -0,0 +1,195 @@
+/***************************************************************************
+                          streamBuffer_impl.cpp  -  description
+                             -------------------
+    begin                : Don Mai 15 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "streamBuffer_impl.h"
+
+#include <string.h>
+
+using namespace Arts;
+
+// packets the decoder may have asked for at a time, and their size
+static const int PACKET_COUNT = 8;
+static const unsigned long PACKET_SIZE = 4096;
+// defaults, about 16 and 4 seconds of a 128 kbit/s stream
+static const long DEFAULT_SIZE = 256 * 1024;
+static const long DEFAULT_PREFETCH = 64 * 1024;
+
+
+StreamBuffer_impl::StreamBuffer_impl() :
+m_ring( DEFAULT_SIZE ),
+m_start( 0 ),
+m_fill( 0 ),
+m_prefetch( DEFAULT_PREFETCH ),
+m_inPos( 0 ),
+m_underruns( 0 ),
+m_received( 0 ),
+m_buffering( true ),
+m_finished( false )
+{
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void StreamBuffer_impl::bufferSize( long newValue )
+{
+    if ( newValue < static_cast<long>( PACKET_SIZE ) )
+        newValue = PACKET_SIZE;
+
+    m_ring.assign( newValue, 0 );
+    m_start = 0;
+    m_fill = 0;
+}
+
+
+
+void StreamBuffer_impl::finish()
+{
+    m_finished = true;
+    process();
+}
+
+
+
+void StreamBuffer_impl::streamStart()
+{
+    outdata.setPull( PACKET_COUNT, PACKET_SIZE );
+}
+
+
+
+void StreamBuffer_impl::streamEnd()
+{
+    outdata.endPull();
+
+// hand everything back, the source may be gone already
+    while ( !m_inQueue.empty() )
+    {
+        m_inQueue.front()->processed();
+        m_inQueue.pop();
+    }
+
+    while ( !m_sendQueue.empty() )
+        m_sendQueue.pop();
+}
+
+
+
+void StreamBuffer_impl::process_indata( DataPacket<mcopbyte> *packet )
+{
+    m_inQueue.push( packet );
+    process();
+}
+
+
+
+void StreamBuffer_impl::request_outdata( DataPacket<mcopbyte> *packet )
+{
+    m_sendQueue.push( packet );
+    process();
+}
+
+
+
+void StreamBuffer_impl::process()
+{
+// taking input makes data to send, sending makes room for input
+    bool progress = true;
+
+    while ( progress )
+    {
+        progress = takeInput();
+        progress = sendOutput() || progress;
+    }
+
+    if ( !m_buffering && m_fill == 0 && !m_finished && !m_sendQueue.empty() )
+    {
+// the decoder waits for data we don't have, it's going to stutter
+        m_buffering = true;
+        ++m_underruns;
+    }
+}
+
+
+
+bool StreamBuffer_impl::takeInput()
+{
+    bool progress = false;
+    const unsigned long size = m_ring.size();
+
+    while ( !m_inQueue.empty() && m_fill < size )
+    {
+        DataPacket<mcopbyte> *packet = m_inQueue.front();
+        const unsigned long left = packet->size - m_inPos;
+        const unsigned long end = ( m_start + m_fill ) % size;
+        const unsigned long count = left < size - m_fill ? left : size - m_fill;
+
+// in two pieces if it wraps around
+        const unsigned long first = count < size - end ? count : size - end;
+        memcpy( &m_ring[end], packet->contents + m_inPos, first );
+        memcpy( &m_ring[0], packet->contents + m_inPos + first, count - first );
+
+        m_fill += count;
+        m_inPos += count;
+        m_received += count;
+        progress = true;
+
+        if ( m_inPos == static_cast<unsigned long>( packet->size ) )
+        {
+            packet->processed();
+            m_inQueue.pop();
+            m_inPos = 0;
+        }
+    }
+
+    if ( m_buffering && ( m_fill >= static_cast<unsigned long>( m_prefetch ) || m_fill == size || m_finished ) )
+        m_buffering = false;
+
+    return progress;
+}
+
+
+
+bool StreamBuffer_impl::sendOutput()
+{
+    bool progress = false;
+    const unsigned long size = m_ring.size();
+
+    while ( !m_buffering && !m_sendQueue.empty() && m_fill > 0 )
+    {
+        DataPacket<mcopbyte> *packet = m_sendQueue.front();
+        const unsigned long count = m_fill < PACKET_SIZE ? m_fill : PACKET_SIZE;
+        const unsigned long first = count < size - m_start ? count : size - m_start;
+
+        memcpy( packet->contents, &m_ring[m_start], first );
+        memcpy( packet->contents + first, &m_ring[0], count - first );
+
+        m_start = ( m_start + count ) % size;
+        m_fill -= count;
+        progress = true;
+
+        packet->size = count;
+        packet->send();
+        m_sendQueue.pop();
+    }
+
+    return progress;
+}
+
+
+REGISTER_IMPLEMENTATION( StreamBuffer_impl );
@@ -0,0 +1,83 @@
+/***************************************************************************
+                          streamBuffer_impl.h  -  description
+                             -------------------
+    begin                : Don Mai 15 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef STREAMBUFFER_IMPL_H
+#define STREAMBUFFER_IMPL_H
+
+#include "amarokarts.h"
+
+#include <kmedia2.h>
+#include <stdsynthmodule.h>
+
+#include <queue>
+#include <vector>
+
+/**
+ * Server side of Amarok::StreamBuffer. Incoming packets the ring has no room
+ * for are held back unprocessed, which stops the source until the decoder
+ * catches up. Requests from the decoder are held back while buffering.
+ *@author mark
+ */
+
+class StreamBuffer_impl : virtual public Amarok::StreamBuffer_skel, virtual public Arts::StdSynthModule
+{
+    public:
+        StreamBuffer_impl();
+
+        long bufferSize() { return m_ring.size(); }
+        void bufferSize( long newValue );
+        long prefetch() { return m_prefetch; }
+        void prefetch( long newValue ) { m_prefetch = newValue; }
+        float fill() { return m_ring.empty() ? 0.0 : static_cast<float>( m_fill ) / m_ring.size(); }
+        long underruns() { return m_underruns; }
+        long received() { return m_received; }
+        bool buffering() { return m_buffering; }
+
+        bool eof() { return m_finished && m_fill == 0; }
+        bool seekOk() { return false; }
+        long size() { return -1; }
+        long seek( long ) { return -1; }
+
+        void finish();
+
+        void streamStart();
+        void streamEnd();
+
+        void process_indata( Arts::DataPacket<Arts::mcopbyte> *packet );
+        void request_outdata( Arts::DataPacket<Arts::mcopbyte> *packet );
+
+    private:
+        bool takeInput();
+        bool sendOutput();
+        void process();
+
+// ATTRIBUTES ------
+        std::vector<Arts::mcopbyte> m_ring;
+        unsigned long m_start;                  // oldest byte in the ring
+        unsigned long m_fill;
+        long m_prefetch;
+
+        std::queue<Arts::DataPacket<Arts::mcopbyte>*> m_inQueue;      // waiting for room in the ring
+        unsigned long m_inPos;                  // bytes of the first one already taken
+        std::queue<Arts::DataPacket<Arts::mcopbyte>*> m_sendQueue;    // waiting for data
+
+        long m_underruns;
+        long m_received;
+        bool m_buffering;
+        bool m_finished;
+};
+#endif
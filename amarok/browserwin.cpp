@@ -17,8 +17,10 @@
 
 #include "browserwin.h"
 #include "browserwidget.h"
+#include "metabundle.h"
 #include "playlistwidget.h"
 #include "playlistitem.h"
+#include "playlistmodel.h"
 #include "expandbutton.h"
 #include "playerapp.h"
 
@@ -38,7 +40,6 @@
 #include <qdir.h>
 #include <qbitmap.h>
 #include <qpixmap.h>
-#include <qptrlist.h>
 #include <qtooltip.h>
 
 #include <kaction.h>
@@ -47,12 +48,11 @@
 #include <kdebug.h>
 #include <kdirlister.h>
 #include <kfileitem.h>
-#include <kfilemetainfo.h>
 #include <kglobalsettings.h>
 #include <klineedit.h>
 #include <kmimetype.h>
-#include <krandomsequence.h>
 #include <kstandarddirs.h>
+#include <ksycoca.h>
 #include <ktip.h>
 #include <kurl.h>
 #include <kurlcompletion.h>
@@ -62,6 +62,9 @@
 #include <arts/kmedia2.h>
 #include <arts/soundserver.h>
 
+// values of m_extensions
+enum { NotPlayable, Playable, Ambiguous };
+
 BrowserWin::BrowserWin( QWidget *parent, const char *name ) :
 QWidget( parent, name, Qt::WPaintUnclipped )
 {
@@ -75,6 +78,10 @@ QWidget( parent, name, Qt::WPaintUnclipped )
     m_pActionCollection = new KActionCollection( this );
     m_pActionCollection->setAutoConnectShortcuts( true );
 
+    m_playableTypesRead = false;
+// new MIME types or patterns, installed with a new PlayObject for example
+    connect( KSycoca::self(), SIGNAL( databaseChanged() ), this, SLOT( slotMimeTypesChanged() ) );
+
     initChildren();
 
     connect( m_pBrowserWidget, SIGNAL( doubleClicked( QListViewItem* ) ),
@@ -83,8 +90,8 @@ QWidget( parent, name, Qt::WPaintUnclipped )
     connect( m_pBrowserWidget, SIGNAL( browserDrop() ),
         this, SLOT( slotBrowserDrop() ) );
 
-    connect( m_pPlaylistWidget, SIGNAL( rightButtonPressed( QListViewItem*, const QPoint&, int ) ),
-        this, SLOT( slotPlaylistRightButton( QListViewItem*, const QPoint&) ) );
+    connect( m_pPlaylistWidget, SIGNAL( rightButtonPressed( int, const QPoint& ) ),
+        this, SLOT( slotPlaylistRightButton( int, const QPoint& ) ) );
 
     connect( m_pButtonSort, SIGNAL( clicked() ),
         this, SLOT( slotSortPlaylist() ) );
@@ -136,8 +143,6 @@ void BrowserWin::initChildren()
     QWidget *pPlaylistWidgetContainer = new QWidget( m_pSplitter );
     m_pPlaylistWidget = new PlaylistWidget( pPlaylistWidgetContainer );
     m_pPlaylistWidget->setAcceptDrops( true );
-    m_pPlaylistWidget->setSorting( -1 );
-    m_pPlaylistWidget->setSelectionMode( QListView::Extended );
 
     m_pBrowserLineEdit = new KLineEdit( pBrowserWidgetContainer );
     QToolTip::add( m_pBrowserLineEdit, "Enter directory/URL" );
@@ -177,7 +182,6 @@ void BrowserWin::initChildren()
     layH->addWidget( m_pButtonPlay );
 
     m_pBrowserWidget->addColumn( "Filebrowser" );
-    m_pPlaylistWidget->addColumn( "Playlist" );
 }
 
 
@@ -213,7 +217,7 @@ void BrowserWin::slotBrowserDoubleClicked( QListViewItem* pItem )
         }
 
         else if ( isFileValid( fileItem.url() ) )
-            m_pPlaylistWidget->addItem( (PlaylistItem*) 1, fileItem.url() );
+            m_pPlaylistWidget->appendItem( fileItem.url() );
     }
 }
 
@@ -221,91 +225,155 @@ void BrowserWin::slotBrowserDoubleClicked( QListViewItem* pItem )
 
 void BrowserWin::slotSortPlaylist()
 {
-    m_pPlaylistWidget->setSorting( 0, true );
-    m_pPlaylistWidget->sort();
-    m_pPlaylistWidget->setSorting( -1 );
+    m_pPlaylistWidget->sort( true );
 }
 
 
 
 void BrowserWin::slotSortDescPlaylist()
 {
-    m_pPlaylistWidget->setSorting( 0, false );
-    m_pPlaylistWidget->sort();
-    m_pPlaylistWidget->setSorting( -1 );
+    m_pPlaylistWidget->sort( false );
 }
 
 
 
 void BrowserWin::slotShufflePlaylist()
 {
-// not evil, but corrrrect :)
-    QPtrList<QListViewItem> list;
+    m_pPlaylistWidget->shuffle();
+}
 
-    while ( m_pPlaylistWidget->childCount() )
-    {
-        list.append( m_pPlaylistWidget->firstChild() );
-        m_pPlaylistWidget->takeItem( m_pPlaylistWidget->firstChild() );
-    }
 
-                                                  // initalize with seed
-    KRandomSequence seq( static_cast<long>( KApplication::random() ) );
-    seq.randomize( &list );
 
-    for ( unsigned int i = 0; i < list.count(); i++ )
-    {
-        m_pPlaylistWidget->insertItem( list.at( i ) );
-    }
+void BrowserWin::slotBrowserDrop()
+{
+    m_pPlaylistWidget->removeSelected();
 }
 
 
 
-void BrowserWin::slotBrowserDrop()
+bool BrowserWin::isFileValid( const KURL &url )
 {
-    QListViewItem *item, *item1;
-    item = m_pPlaylistWidget->firstChild();
+    bool playable;
 
-    while ( item != NULL )
-    {
-        item1 = item;
-        item = item->nextSibling();
+    if ( isExtensionPlayable( url.fileName(), playable ) )
+        return playable;
 
-        if ( item1->isSelected()    )
-            delete item1;
-    }
+// no extension, or one that doesn't tell, only the contents can
+    KFileItem fileItem( KFileItem::Unknown, KFileItem::Unknown, url );
+    return isMimeTypePlayable( fileItem.determineMimeType()->name() );
 }
 
 
 
-bool BrowserWin::isFileValid( const KURL &url )
+bool BrowserWin::isFileValid( const QString &path )
 {
+    bool playable;
+
+    if ( isExtensionPlayable( path.mid( path.findRev( '/' ) + 1 ), playable ) )
+        return playable;
+
+    KURL url;
+    url.setPath( path );
+
     KFileItem fileItem( KFileItem::Unknown, KFileItem::Unknown, url );
-    KMimeType::Ptr mimeTypePtr = fileItem.determineMimeType();
+    return isMimeTypePlayable( fileItem.determineMimeType()->name() );
+}
+
+
 
+void BrowserWin::refreshPlayableTypes()
+{
+    m_playableTypes.clear();
+    m_extensions.clear();
+    m_playableTypesRead = false;
+}
+
+
+
+void BrowserWin::readPlayableTypes()
+{
+// one query for all PlayObjects, instead of one per file and MIME type
     Arts::TraderQuery query;
     query.supports( "Interface", "Arts::PlayObject" );
-    query.supports( "MimeType", mimeTypePtr->name().latin1() );
     std::vector<Arts::TraderOffer> *offers = query.query();
 
-    if ( offers->empty() )
+    for ( std::vector<Arts::TraderOffer>::iterator it = offers->begin(); it != offers->end(); ++it )
     {
-        delete offers;
-        return false;
+        std::vector<std::string> *types = it->getProperty( "MimeType" );
+
+        for ( std::vector<std::string>::iterator type = types->begin(); type != types->end(); ++type )
+            m_playableTypes.insert( QString::fromLatin1( type->c_str() ), true );
+
+        delete types;
     }
 
     delete offers;
+    m_playableTypesRead = true;
+
+    kdDebug() << "BrowserWin: " << m_playableTypes.count() << " playable MIME types" << endl;
+}
+
+
+
+bool BrowserWin::isExtensionPlayable( const QString &fileName, bool &playable )
+{
+    const int dot = fileName.findRev( '.' );
+
+// hidden files without extension start with a dot
+    if ( dot < 1 || dot == static_cast<int>( fileName.length() ) - 1 )
+        return false;
+
+    const QString extension = fileName.mid( dot + 1 ).lower();
+    QMap<QString, int>::Iterator it = m_extensions.find( extension );
+
+    if ( it == m_extensions.end() )
+    {
+// only the pattern matters, so any name with this extension does
+        KMimeType::Ptr mimeType = KMimeType::findByPath( "file." + extension, 0, true );
+
+        int result;
+
+        if ( mimeType->name() == KMimeType::defaultMimeType() )
+            result = Ambiguous;
+        else
+            result = isMimeTypePlayable( mimeType->name() ) ? Playable : NotPlayable;
+
+        it = m_extensions.insert( extension, result );
+    }
+
+    if ( it.data() == Ambiguous )
+        return false;
+
+    playable = it.data() == Playable;
     return true;
 }
 
 
 
-void BrowserWin::slotPlaylistRightButton( QListViewItem */*pItem*/, const QPoint &rPoint )
+bool BrowserWin::isMimeTypePlayable( const QString &mimeType )
+{
+    if ( !m_playableTypesRead )
+        readPlayableTypes();
+
+    return m_playableTypes.contains( mimeType );
+}
+
+
+
+void BrowserWin::slotMimeTypesChanged()
+{
+    refreshPlayableTypes();
+}
+
+
+
+void BrowserWin::slotPlaylistRightButton( int /*row*/, const QPoint &rPoint )
 {
     QPopupMenu popup( this );
     int item1 = popup.insertItem( "Show File Info", this, SLOT( slotShowInfo() ) );
 
 // only enable when file is selected
-    if ( !m_pPlaylistWidget->currentItem() )
+    if ( m_pPlaylistWidget->currentRow() == -1 )
         popup.setItemEnabled( item1, false );
 
     /*int item2 = */popup.insertItem( "Play Track", this, SLOT( slotMenuPlay() ) );
@@ -318,7 +386,13 @@ void BrowserWin::slotPlaylistRightButton( QListViewItem */*pItem*/, const QPoint
 
 void BrowserWin::slotShowInfo()
 {
-    PlaylistItem *pItem = static_cast<PlaylistItem*>( m_pPlaylistWidget->currentItem() );
+    int row = m_pPlaylistWidget->currentRow();
+
+    if ( row == -1 )
+        return;
+
+    const PlaylistModel *pModel = m_pPlaylistWidget->model();
+    KURL url = pModel->url( row );
 
     QMessageBox *box = new QMessageBox( "Track Information", 0,
         QMessageBox::Information, QMessageBox::Ok, QMessageBox::NoButton,
@@ -327,22 +401,28 @@ void BrowserWin::slotShowInfo()
 
     QString str( "<html><body><table border=""1"">" );
 
-    if ( pItem->url().protocol() == "file" )
+    if ( url.protocol() == "file" )
     {
-        KFileMetaInfo metaInfo( pItem->url().path(), QString::null, KFileMetaInfo::Everything );
-//    KFileItem fileItem( KFileItem::Unknown, KFileItem::Unknown, pItem->url() );
-//    KFileMetaInfo metaInfo = fileItem.metaInfo();
-        if ( metaInfo.isValid() && !metaInfo.isEmpty() )
+        const MetaBundle bundle = m_pPlaylistWidget->metaInfo( row );
+
+        if ( !bundle.isEmpty() )
         {
-            str += "<tr><td>Title   </td><td>" + metaInfo.item( "Title" ).string() + "</td></tr>";
-            str += "<tr><td>Artist  </td><td>" + metaInfo.item( "Artist" ).string() + "</td></tr>";
-            str += "<tr><td>Album   </td><td>" + metaInfo.item( "Album" ).string() + "</td></tr>";
-            str += "<tr><td>Genre   </td><td>" + metaInfo.item( "Genre" ).string() + "</td></tr>";
-            str += "<tr><td>Date    </td><td>" + metaInfo.item( "Date" ).string() + "</td></tr>";
-            str += "<tr><td>Comment </td><td>" + metaInfo.item( "Comment" ).string() + "</td></tr>";
-            str += "<tr><td>Length  </td><td>" + metaInfo.item( "Length" ).string() + "</td></tr>";
-            str += "<tr><td>Bitrate </td><td>" + metaInfo.item( "Bitrate" ).string() + "</td></tr>";
-            str += "<tr><td>Samplerate  </td><td>" + metaInfo.item( "Sample Rate" ).string() + "</td></tr>";
+            QString length( "?" ), bitrate( "?" ), sampleRate( "?" );
+
+            if ( bundle.m_length >= 0 )
+                length.sprintf( "%d:%02d", bundle.m_length / 60, bundle.m_length % 60 );
+            if ( bundle.m_bitrate > 0 )
+                bitrate = QString::number( bundle.m_bitrate ) + " kbps";
+            if ( bundle.m_sampleRate > 0 )
+                sampleRate = QString::number( bundle.m_sampleRate ) + " Hz";
+
+            str += "<tr><td>Title   </td><td>" + bundle.m_title + "</td></tr>";
+            str += "<tr><td>Artist  </td><td>" + bundle.m_artist + "</td></tr>";
+            str += "<tr><td>Album   </td><td>" + bundle.m_album + "</td></tr>";
+            str += "<tr><td>Genre   </td><td>" + bundle.m_genre + "</td></tr>";
+            str += "<tr><td>Length  </td><td>" + length + "</td></tr>";
+            str += "<tr><td>Bitrate </td><td>" + bitrate + "</td></tr>";
+            str += "<tr><td>Samplerate  </td><td>" + sampleRate + "</td></tr>";
         }
         else
         {
@@ -351,8 +431,8 @@ void BrowserWin::slotShowInfo()
     }
     else
     {
-        str += "<tr><td>Stream   </td><td>" + pItem->url().url() + "</td></tr>";
-        str += "<tr><td>Title    </td><td>" + pItem->text( 0 ) + "</td></tr>";
+        str += "<tr><td>Stream   </td><td>" + url.url() + "</td></tr>";
+        str += "<tr><td>Title    </td><td>" + pModel->text( row ) + "</td></tr>";
     }
 
     str.append( "</table></body></html>" );
@@ -365,22 +445,27 @@ void BrowserWin::slotShowInfo()
 
 void BrowserWin::slotMenuPlay()
 {
-    m_pPlaylistWidget->setCurrentTrack( m_pPlaylistWidget->currentItem() );
-    pApp->slotPlay();
+    if ( m_pPlaylistWidget->currentRow() != -1 )
+    {
+        m_pPlaylistWidget->setCurrentTrack( m_pPlaylistWidget->currentRow() );
+        pApp->slotPlay();
+    }
 }
 
 
 
 void BrowserWin::slotKeyUp()
 {
-    KListView *pListView = 0L;
-
     if ( m_pPlaylistLineEdit->hasFocus() )
-        pListView = m_pPlaylistWidget;
+    {
+        m_pPlaylistWidget->moveCursor( -1 );
+        return;
+    }
 
-    if ( m_pBrowserLineEdit->hasFocus() )
-        pListView = m_pBrowserWidget;
+    if ( !m_pBrowserLineEdit->hasFocus() )
+        return;
 
+    KListView *pListView = m_pBrowserWidget;
     QListViewItem *item = pListView->currentItem();
 
     if ( item->itemAbove() )
@@ -398,14 +483,16 @@ void BrowserWin::slotKeyUp()
 
 void BrowserWin::slotKeyDown()
 {
-    KListView *pListView = 0L;
-
     if ( m_pPlaylistLineEdit->hasFocus() )
-        pListView = m_pPlaylistWidget;
+    {
+        m_pPlaylistWidget->moveCursor( 1 );
+        return;
+    }
 
-    if ( m_pBrowserLineEdit->hasFocus() )
-        pListView = m_pBrowserWidget;
+    if ( !m_pBrowserLineEdit->hasFocus() )
+        return;
 
+    KListView *pListView = m_pBrowserWidget;
     QListViewItem *item = pListView->currentItem();
 
     if ( item->itemBelow() )
@@ -423,14 +510,16 @@ void BrowserWin::slotKeyDown()
 
 void BrowserWin::slotKeyPageUp()
 {
-    KListView *pListView = 0L;
-
     if ( m_pPlaylistLineEdit->hasFocus() )
-        pListView = m_pPlaylistWidget;
+    {
+        m_pPlaylistWidget->moveCursor( 1 - m_pPlaylistWidget->visibleRows() );
+        return;
+    }
 
-    if ( m_pBrowserLineEdit->hasFocus() )
-        pListView = m_pBrowserWidget;
+    if ( !m_pBrowserLineEdit->hasFocus() )
+        return;
 
+    KListView *pListView = m_pBrowserWidget;
     QListViewItem *item = pListView->currentItem();
 
     for ( int i = 1; i < pListView->visibleHeight() / item->height(); i++ )
@@ -453,14 +542,16 @@ void BrowserWin::slotKeyPageUp()
 
 void BrowserWin::slotKeyPageDown()
 {
-    KListView *pListView = 0L;
-
     if ( m_pPlaylistLineEdit->hasFocus() )
-        pListView = m_pPlaylistWidget;
+    {
+        m_pPlaylistWidget->moveCursor( m_pPlaylistWidget->visibleRows() - 1 );
+        return;
+    }
 
-    if ( m_pBrowserLineEdit->hasFocus() )
-        pListView = m_pBrowserWidget;
+    if ( !m_pBrowserLineEdit->hasFocus() )
+        return;
 
+    KListView *pListView = m_pBrowserWidget;
     QListViewItem *item = pListView->currentItem();
 
     for ( int i = 1; i < pListView->visibleHeight() / item->height(); i++ )
@@ -485,10 +576,10 @@ void BrowserWin::slotKeyEnter()
 {
     if ( m_pPlaylistLineEdit->hasFocus() )
     {
-        if ( m_pPlaylistWidget->currentItem() )
+        if ( m_pPlaylistWidget->currentRow() != -1 )
         {
             pApp->slotStop();
-            m_pPlaylistWidget->setCurrentTrack( m_pPlaylistWidget->currentItem() );
+            m_pPlaylistWidget->setCurrentTrack( m_pPlaylistWidget->currentRow() );
             pApp->slotPlay();
         }
     }
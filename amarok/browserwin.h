@@ -18,8 +18,10 @@
 #ifndef BROWSERWIN_H
 #define BROWSERWIN_H
 
-#include <qwidget.h>
+#include <qmap.h>
 #include <qpixmap.h>
+#include <qstring.h>
+#include <qwidget.h>
 
 class BrowserWidget;
 class PlaylistItem;
@@ -52,6 +54,8 @@ class BrowserWin : public QWidget
         ~BrowserWin();
 
         bool isFileValid( const KURL &url );
+        bool isFileValid( const QString &path );
+        void refreshPlayableTypes();
 // ATTRIBUTES ------
         KActionCollection *m_pActionCollection;
         ExpandButton *m_pButtonAdd;
@@ -78,7 +82,7 @@ class BrowserWin : public QWidget
         void slotSortDescPlaylist();
         void slotShufflePlaylist();
         void slotBrowserDrop();
-        void slotPlaylistRightButton( QListViewItem *pItem, const QPoint &rPoint );
+        void slotPlaylistRightButton( int row, const QPoint &rPoint );
         void slotShowInfo();
         void slotMenuPlay();
         void slotKeyUp();
@@ -87,6 +91,9 @@ class BrowserWin : public QWidget
         void slotKeyPageDown();
         void slotKeyEnter();
         void slotKeyDelete();
+
+    private slots:
+        void slotMimeTypesChanged();
                 
         signals:
         void signalHide();
@@ -94,9 +101,16 @@ class BrowserWin : public QWidget
     private:
         void initChildren();
         void closeEvent( QCloseEvent *e );
+        void readPlayableTypes();
+        bool isExtensionPlayable( const QString &fileName, bool &playable );
+        bool isMimeTypePlayable( const QString &mimeType );
 
 // ATTRIBUTES ------
         QColor m_TextColor;
         QPixmap m_bgPixmap;
+
+        QMap<QString, bool> m_playableTypes;    // every MIME type an aRts PlayObject supports
+        QMap<QString, int> m_extensions;        // lowercase extension -> Playable, NotPlayable or Ambiguous
+        bool m_playableTypesRead;
 };
 #endif
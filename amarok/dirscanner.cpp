@@ -0,0 +1,332 @@
+/***************************************************************************
+                          dirscanner.cpp  -  description
+                             -------------------
+    begin                : Son Mai 11 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "dirscanner.h"
+
+#include <qapplication.h>
+#include <qcstring.h>
+#include <qdeepcopy.h>
+#include <qevent.h>
+#include <qfile.h>
+#include <qmap.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qthread.h>
+#include <qvaluelist.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// posted when the list of found files gets its first entry
+static const int FILES_EVENT = QEvent::User + 110;
+// posted when the last thread is done
+static const int FINISHED_EVENT = QEvent::User + 111;
+// listing directories is mostly waiting for the disk, more threads than that only seek around
+static const int MAX_THREADS = 4;
+
+
+DirScannerThread::DirScannerThread( DirScanner *scanner ) :
+m_pScanner( scanner )
+{
+}
+
+
+
+void DirScannerThread::run()
+{
+    DirScanner::Dir dir;
+
+    while ( m_pScanner->nextDir( dir ) )
+        m_pScanner->listDir( dir );
+
+    m_pScanner->threadDone();
+}
+
+
+
+DirScanner::DirScanner( bool recursive, bool followSymlinks, QObject *parent, const char *name ) : QObject( parent, name ),
+m_recursive( recursive ),
+m_followSymlinks( followSymlinks ),
+m_listing( 0 ),
+m_running( 0 ),
+m_cancelled( false )
+{
+}
+
+
+
+DirScanner::~DirScanner()
+{
+    cancel();
+
+    for ( DirScannerThread *thread = m_threads.first(); thread; thread = m_threads.next() )
+    {
+        thread->wait();
+        delete thread;
+    }
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void DirScanner::scan( const QStringList &dirs )
+{
+    if ( !m_threads.isEmpty() )
+        return;
+
+    for ( QStringList::ConstIterator it = dirs.begin(); it != dirs.end(); ++it )
+    {
+        struct stat st;
+
+        if ( ::stat( QFile::encodeName( *it ), &st ) != 0 || !S_ISDIR( st.st_mode ) )
+            continue;
+
+        const Dir key( QString::null, st.st_dev, st.st_ino );
+
+        if ( m_visited.contains( key ) )
+            continue;
+
+        m_visited.insert( key, true );
+// QString's reference counting is not thread safe, the workers get a copy of their own
+        Dir dir( QDeepCopy<QString>( *it ), st.st_dev, st.st_ino );
+        dir.m_slot = m_slots.append( Slot() );
+        m_dirs.append( dir );
+    }
+
+    const long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    const int threads = QMIN( QMAX( static_cast<int>( cpus ), 1 ) + 1, MAX_THREADS );
+
+    m_running = threads;
+
+    for ( int i = 0; i < threads; ++i )
+        m_threads.append( new DirScannerThread( this ) );
+
+    for ( DirScannerThread *thread = m_threads.first(); thread; thread = m_threads.next() )
+        thread->start();
+}
+
+
+
+void DirScanner::cancel()
+{
+    QMutexLocker locker( &m_mutex );
+
+    m_cancelled = true;
+    m_dirs.clear();
+    m_slots.clear();
+    m_files.clear();
+    m_dirWait.wakeAll();
+}
+
+
+
+QStringList DirScanner::takeFiles()
+{
+    QMutexLocker locker( &m_mutex );
+
+    QStringList files = m_files;
+    m_files.clear();
+
+    return files;
+}
+
+
+
+bool DirScanner::nextDir( Dir &dir )
+{
+    QMutexLocker locker( &m_mutex );
+
+// an empty queue only means we're done when nobody is listing a directory that adds more
+    while ( m_dirs.isEmpty() && m_listing > 0 && !m_cancelled )
+        m_dirWait.wait( &m_mutex );
+
+    if ( m_cancelled || m_dirs.isEmpty() )
+    {
+        m_dirWait.wakeAll();
+        return false;
+    }
+
+    dir = m_dirs.first();
+    m_dirs.remove( m_dirs.begin() );
+    ++m_listing;
+
+    return true;
+}
+
+
+
+void DirScanner::listDir( const Dir &dir )
+{
+    QStringList files;
+    QMap<QString, Dir> subDirs;         // sorted by path
+
+    QCString prefix = QFile::encodeName( dir.m_path );
+
+    if ( !prefix.isEmpty() && prefix[ prefix.length() - 1 ] != '/' )
+        prefix += '/';
+
+    DIR *handle = ::opendir( prefix );
+
+    if ( handle )
+    {
+        struct dirent *entry;
+
+        while ( !m_cancelled && ( entry = ::readdir( handle ) ) )
+        {
+            const char *name = entry->d_name;
+
+            if ( name[0] == '.' && ( name[1] == '\0' || ( name[1] == '.' && name[2] == '\0' ) ) )
+                continue;
+
+            const QCString path = prefix + name;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+// most filesystems tell the type right away, which saves a stat() per file
+            if ( entry->d_type == DT_REG )
+            {
+                files.append( QFile::decodeName( path ) );
+                continue;
+            }
+
+            if ( entry->d_type == DT_DIR && !m_recursive )
+                continue;
+#endif
+
+            struct stat st;
+
+            if ( ::lstat( path, &st ) != 0 )
+                continue;
+
+            if ( S_ISLNK( st.st_mode ) )
+            {
+// dangling links are skipped like anything else we can't read
+                if ( ::stat( path, &st ) != 0 )
+                    continue;
+
+                if ( S_ISDIR( st.st_mode ) && !m_followSymlinks )
+                    continue;
+            }
+
+            if ( S_ISDIR( st.st_mode ) )
+            {
+                if ( m_recursive )
+                {
+                    const QString subDir = QFile::decodeName( path );
+                    subDirs.insert( subDir, Dir( subDir, st.st_dev, st.st_ino ) );
+                }
+            }
+            else if ( S_ISREG( st.st_mode ) )
+                files.append( QFile::decodeName( path ) );
+        }
+
+        ::closedir( handle );
+    }
+
+    files.sort();
+    dirDone( dir, files, subDirs );
+}
+
+
+
+void DirScanner::dirDone( const Dir &dir, QStringList &files, QMap<QString, Dir> &subDirs )
+{
+    QMutexLocker locker( &m_mutex );
+
+// cancel() has thrown the slots away, dir.m_slot points nowhere
+    if ( !m_cancelled )
+    {
+        ( *dir.m_slot ).m_files = files;
+        ( *dir.m_slot ).m_done = true;
+
+// subdirectories go in front, in reverse, so the tree is walked depth first and in order, like a
+// recursion. Their slots follow their parent's, so their files come before its next sibling's
+        SlotIterator slot = dir.m_slot;
+        ++slot;
+
+        QMap<QString, Dir>::Iterator it = subDirs.end();
+
+        while ( it != subDirs.begin() )
+        {
+            --it;
+            const Dir key( QString::null, it.data().m_device, it.data().m_inode );
+
+// seen before: a symlink loop, or a second link to the same directory
+            if ( m_visited.contains( key ) )
+                continue;
+
+            m_visited.insert( key, true );
+            slot = m_slots.insert( slot, Slot() );
+            it.data().m_slot = slot;
+            m_dirs.prepend( it.data() );
+        }
+
+        releaseFiles();
+    }
+
+// drop the worker's references while still locked, from now on the strings belong to whoever takes them
+    files.clear();
+    subDirs.clear();
+
+    --m_listing;
+    m_dirWait.wakeAll();
+}
+
+
+
+void DirScanner::releaseFiles()
+{
+    const bool first = m_files.isEmpty();
+
+    while ( !m_slots.isEmpty() && m_slots.first().m_done )
+    {
+        m_files += m_slots.first().m_files;
+        m_slots.remove( m_slots.begin() );
+    }
+
+// one event per batch, everything released until the GUI gets to it is delivered together
+    if ( first && !m_files.isEmpty() )
+        QApplication::postEvent( this, new QCustomEvent( FILES_EVENT ) );
+}
+
+
+
+void DirScanner::threadDone()
+{
+    m_mutex.lock();
+    const bool last = --m_running == 0;
+    m_mutex.unlock();
+
+    if ( last )
+        QApplication::postEvent( this, new QCustomEvent( FINISHED_EVENT ) );
+}
+
+
+
+void DirScanner::customEvent( QCustomEvent *e )
+{
+    if ( e->type() == FILES_EVENT )
+        emit filesFound();
+    else if ( e->type() == FINISHED_EVENT )
+        emit finished();
+}
+
+
+#include "dirscanner.moc"
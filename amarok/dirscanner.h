@@ -0,0 +1,140 @@
+/***************************************************************************
+                          dirscanner.h  -  description
+                             -------------------
+    begin                : Son Mai 11 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef DIRSCANNER_H
+#define DIRSCANNER_H
+
+#include <qmap.h>
+#include <qmutex.h>
+#include <qobject.h>
+#include <qptrlist.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qthread.h>
+#include <qvaluelist.h>
+#include <qwaitcondition.h>
+
+#include <sys/types.h>
+
+class QCustomEvent;
+class DirScanner;
+
+/**
+ * Worker thread of DirScanner. Lists directories until there are none left.
+ */
+
+class DirScannerThread : public QThread
+{
+    public:
+        DirScannerThread( DirScanner *scanner );
+
+    protected:
+        void run();
+
+    private:
+        DirScanner *m_pScanner;
+};
+
+
+
+/**
+ * Walks local directory trees with a few threads, using readdir() and
+ * stat() directly. Every directory is entered only once, identified by
+ * device and inode, so symlink loops end the walk instead of the recursion.
+ * The files of each directory are sorted and handed out in the order a
+ * recursion would find them, no matter which thread lists what: every
+ * directory has a slot in that order, and the files are released once all
+ * slots in front of theirs are filled. The receiver is told with
+ * filesFound() and gets them with takeFiles(), then finished() is emitted
+ * once all threads are done, or cancelled.
+ * All public methods must be called from the GUI thread.
+ *@author mark
+ */
+
+class DirScanner : public QObject
+{
+    Q_OBJECT
+    public:
+        DirScanner( bool recursive, bool followSymlinks, QObject *parent = 0, const char *name = 0 );
+        ~DirScanner();
+
+        void scan( const QStringList &dirs );
+        void cancel();
+        bool isCancelled() const { return m_cancelled; }
+        QStringList takeFiles();
+
+    signals:
+        void filesFound();
+        void finished();
+
+    private:
+        friend class DirScannerThread;
+
+        class Slot
+        {
+            public:
+                Slot() : m_done( false ) {}
+
+// ATTRIBUTES ------
+                QStringList m_files;
+                bool m_done;                // listed, the files can go once the slots in front are done
+        };
+
+        typedef QValueList<Slot>::Iterator SlotIterator;
+
+        class Dir
+        {
+            public:
+                Dir() : m_device( 0 ), m_inode( 0 ) {}
+                Dir( const QString &path, dev_t device, ino_t inode ) :
+                    m_path( path ), m_device( device ), m_inode( inode ) {}
+
+                bool operator<( const Dir &other ) const
+                {
+                    return m_device < other.m_device || ( m_device == other.m_device && m_inode < other.m_inode );
+                }
+
+// ATTRIBUTES ------
+                QString m_path;
+                dev_t m_device;
+                ino_t m_inode;
+                SlotIterator m_slot;        // where its files go, only touched with the mutex held
+        };
+
+        void customEvent( QCustomEvent *e );
+        bool nextDir( Dir &dir );
+        void listDir( const Dir &dir );
+        void dirDone( const Dir &dir, QStringList &files, QMap<QString, Dir> &subDirs );
+        void releaseFiles();
+        void threadDone();
+
+// ATTRIBUTES ------
+        const bool m_recursive;
+        const bool m_followSymlinks;
+
+        QMutex m_mutex;
+        QWaitCondition m_dirWait;
+        QValueList<Dir> m_dirs;             // waiting to be listed
+        QMap<Dir, bool> m_visited;          // every directory queued so far, by device and inode only
+        QValueList<Slot> m_slots;           // one per directory queued and not yet released, in recursion order
+        QStringList m_files;                // released and not yet taken
+        QPtrList<DirScannerThread> m_threads;
+        int m_listing;                      // directories being listed right now
+        int m_running;                      // threads not finished yet
+        volatile bool m_cancelled;
+};
+#endif
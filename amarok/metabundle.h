@@ -0,0 +1,59 @@
+/***************************************************************************
+                          metabundle.h  -  description
+                             -------------------
+    begin                : Die Mai 6 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef METABUNDLE_H
+#define METABUNDLE_H
+
+#include <qstring.h>
+
+/**
+ * The metadata of one track, as far as amaroK uses it.
+ * Numeric fields are -1 when unknown, m_gain is only valid with a m_peak.
+ *@author mark
+ */
+
+class MetaBundle
+{
+    public:
+        MetaBundle() : m_length( -1 ), m_bitrate( -1 ), m_sampleRate( -1 ), m_gain( 0.0 ), m_peak( -1.0 ) {}
+
+        bool isEmpty() const
+        {
+            return m_title.isEmpty() && m_artist.isEmpty() && m_album.isEmpty() && m_genre.isEmpty() &&
+                   m_length < 0 && m_bitrate < 0 && m_sampleRate < 0;
+        }
+
+        QString prettyTitle() const
+        {
+            if ( m_artist.isEmpty() )
+                return m_title;
+
+            return m_artist + " - " + m_title;
+        }
+
+// ATTRIBUTES ------
+        QString m_title;
+        QString m_artist;
+        QString m_album;
+        QString m_genre;
+        int m_length;           // seconds
+        int m_bitrate;          // kbit/s
+        int m_sampleRate;       // Hz
+        float m_gain;           // dB to the ReplayGain reference level, measured while playing
+        float m_peak;           // highest sample, 1.0 is full scale
+};
+#endif
@@ -0,0 +1,425 @@
+/***************************************************************************
+                          metacache.cpp  -  description
+                             -------------------
+    begin                : Mit Mai 7 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "metacache.h"
+#include "metabundle.h"
+#include "tagreader.h"
+
+#include <qdatastream.h>
+#include <qdeepcopy.h>
+#include <qfile.h>
+#include <qmap.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qthread.h>
+#include <qtl.h>
+#include <qvaluelist.h>
+#include <qvaluevector.h>
+
+#include <kdebug.h>
+#include <kfilemetainfo.h>
+#include <ksavefile.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// at about 200 bytes per entry that's 10MB, enough for the biggest collections we know of
+static const uint MAX_ENTRIES = 50000;
+
+static const Q_UINT32 CACHE_MAGIC = 0x616d6b63;      // "amkc"
+static const Q_UINT32 CACHE_VERSION = 2;           // 2 added gain and peak
+
+
+// what doCompact() checks the files against
+struct Stamp
+{
+    QString path;
+    uint size;
+    uint mtime;
+};
+
+
+/**
+ * Runs MetaCache::doCompact(), which stats every cached file.
+ */
+
+class MetaCacheCompactor : public QThread
+{
+    public:
+        MetaCacheCompactor( MetaCache *cache ) : m_pCache( cache ) {}
+
+    protected:
+        void run() { m_pCache->doCompact(); }
+
+    private:
+        MetaCache *m_pCache;
+};
+
+
+
+MetaCache::MetaCache( const QString &fileName ) :
+m_fileName( fileName ),
+m_session( 0 ),
+m_dirty( false ),
+m_pCompactor( 0 ),
+m_abortCompaction( false )
+{
+}
+
+
+
+MetaCache::~MetaCache()
+{
+    if ( m_pCompactor )
+    {
+        m_abortCompaction = true;
+        m_pCompactor->wait();
+        delete m_pCompactor;
+    }
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+bool MetaCache::stamp( const QString &path, uint &size, uint &mtime )
+{
+    struct stat st;
+
+    if ( ::stat( QFile::encodeName( path ), &st ) != 0 )
+        return false;
+
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+
+
+MetaBundle MetaCache::deepCopy( const MetaBundle &bundle )
+{
+// the cache is shared between threads, and QString's reference counting is not thread safe
+    MetaBundle copy( bundle );
+
+    copy.m_title = QDeepCopy<QString>( bundle.m_title );
+    copy.m_artist = QDeepCopy<QString>( bundle.m_artist );
+    copy.m_album = QDeepCopy<QString>( bundle.m_album );
+    copy.m_genre = QDeepCopy<QString>( bundle.m_genre );
+
+    return copy;
+}
+
+
+
+bool MetaCache::find( const QString &path, MetaBundle &bundle )
+{
+    uint size, mtime;
+
+    if ( !stamp( path, size, mtime ) )
+        return false;
+
+    QMutexLocker locker( &m_mutex );
+    QMap<QString, Entry>::Iterator it = m_entries.find( path );
+
+    if ( it == m_entries.end() || it.data().size != size || it.data().mtime != mtime )
+        return false;
+
+    if ( it.data().used != m_session )
+    {
+        it.data().used = m_session;
+        m_dirty = true;
+    }
+
+    bundle = deepCopy( it.data().bundle );
+    return true;
+}
+
+
+
+void MetaCache::insert( const QString &path, const MetaBundle &bundle )
+{
+    Entry entry;
+
+    if ( !stamp( path, entry.size, entry.mtime ) )
+        return;
+
+    entry.bundle = deepCopy( bundle );
+
+    m_mutex.lock();
+    entry.used = m_session;
+    m_entries.replace( QDeepCopy<QString>( path ), entry );
+    m_dirty = true;
+
+    const bool full = m_entries.count() > MAX_ENTRIES + MAX_ENTRIES / 4;
+    m_mutex.unlock();
+
+    if ( full )
+        compact();
+}
+
+
+
+bool MetaCache::read( const QString &path, MetaBundle &bundle )
+{
+    if ( !find( path, bundle ) )
+    {
+        bundle = MetaBundle();
+
+        if ( !TagReader::read( path, bundle ) )
+        {
+            bundle = MetaBundle();
+            readFileMetaInfo( path, bundle );
+        }
+
+// files without any tags are cached as well, so we don't try them again on every start
+        insert( path, bundle );
+    }
+
+    return !bundle.isEmpty();
+}
+
+
+
+void MetaCache::setGain( const QString &path, float gain, float peak )
+{
+    MetaBundle bundle;
+
+// the tags come along if the file isn't cached yet, the gain belongs to the rest of the entry
+    read( path, bundle );
+    bundle.m_gain = gain;
+    bundle.m_peak = peak;
+    insert( path, bundle );
+}
+
+
+
+void MetaCache::readFileMetaInfo( const QString &path, MetaBundle &bundle )
+{
+    KFileMetaInfo metaInfo( path, QString::null, KFileMetaInfo::Everything );
+
+    if ( !metaInfo.isValid() || metaInfo.isEmpty() )
+        return;
+
+// the plugins use "---" for missing tags
+    if ( metaInfo.item( "Title" ).string() != "---" )
+    {
+        bundle.m_title = metaInfo.item( "Title" ).value().toString();
+        bundle.m_artist = metaInfo.item( "Artist" ).value().toString();
+        bundle.m_album = metaInfo.item( "Album" ).value().toString();
+        bundle.m_genre = metaInfo.item( "Genre" ).value().toString();
+    }
+
+    const int length = metaInfo.item( "Length" ).value().toInt();
+    const int bitrate = metaInfo.item( "Bitrate" ).value().toInt();
+    const int sampleRate = metaInfo.item( "Sample Rate" ).value().toInt();
+
+    if ( length > 0 )
+        bundle.m_length = length;
+    if ( bitrate > 0 )
+        bundle.m_bitrate = bitrate;
+    if ( sampleRate > 0 )
+        bundle.m_sampleRate = sampleRate;
+}
+
+
+
+void MetaCache::load()
+{
+    QFile file( m_fileName );
+
+    if ( !file.open( IO_ReadOnly ) )
+        return;
+
+    QDataStream stream( &file );
+    Q_UINT32 magic, version, session, count;
+
+    stream >> magic >> version;
+
+    if ( magic != CACHE_MAGIC || version < 1 || version > CACHE_VERSION )
+    {
+        kdDebug() << "MetaCache: ignoring " << m_fileName << ", wrong format" << endl;
+        return;
+    }
+
+    stream >> session >> count;
+
+    QMutexLocker locker( &m_mutex );
+    m_session = session + 1;
+
+    for ( uint i = 0; i < count && !stream.atEnd(); ++i )
+    {
+        QString path;
+        Entry entry;
+        Q_UINT32 size, mtime, used;
+        Q_INT32 length, bitrate, sampleRate;
+
+        stream >> path >> size >> mtime >> used;
+        stream >> entry.bundle.m_title >> entry.bundle.m_artist >> entry.bundle.m_album >> entry.bundle.m_genre;
+        stream >> length >> bitrate >> sampleRate;
+
+        if ( version >= 2 )
+            stream >> entry.bundle.m_gain >> entry.bundle.m_peak;
+
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.used = used;
+        entry.bundle.m_length = length;
+        entry.bundle.m_bitrate = bitrate;
+        entry.bundle.m_sampleRate = sampleRate;
+
+        m_entries.insert( path, entry );
+    }
+}
+
+
+
+void MetaCache::save()
+{
+    QMutexLocker locker( &m_mutex );
+
+    if ( !m_dirty )
+        return;
+
+// KSaveFile writes to a temporary file, so a crash never leaves us with half a cache
+    KSaveFile file( m_fileName );
+
+    if ( file.status() != 0 )
+        return;
+
+    QDataStream &stream = *file.dataStream();
+
+    stream << CACHE_MAGIC << CACHE_VERSION;
+    stream << static_cast<Q_UINT32>( m_session ) << static_cast<Q_UINT32>( m_entries.count() );
+
+    for ( QMap<QString, Entry>::ConstIterator it = m_entries.begin(); it != m_entries.end(); ++it )
+    {
+        const Entry &entry = it.data();
+
+        stream << it.key();
+        stream << static_cast<Q_UINT32>( entry.size ) << static_cast<Q_UINT32>( entry.mtime ) << static_cast<Q_UINT32>( entry.used );
+        stream << entry.bundle.m_title << entry.bundle.m_artist << entry.bundle.m_album << entry.bundle.m_genre;
+        stream << static_cast<Q_INT32>( entry.bundle.m_length ) << static_cast<Q_INT32>( entry.bundle.m_bitrate );
+        stream << static_cast<Q_INT32>( entry.bundle.m_sampleRate );
+        stream << entry.bundle.m_gain << entry.bundle.m_peak;
+    }
+
+    if ( file.close() )
+        m_dirty = false;
+}
+
+
+
+void MetaCache::compact()
+{
+    QMutexLocker locker( &m_mutex );
+
+    if ( m_pCompactor && m_pCompactor->running() )
+        return;
+
+    if ( !m_pCompactor )
+        m_pCompactor = new MetaCacheCompactor( this );
+
+    m_pCompactor->start();
+}
+
+
+
+void MetaCache::doCompact()
+{
+// stat'ing all files takes a while, so we work on a copy and don't keep the cache locked
+    QValueVector<Stamp> stamps;
+
+    m_mutex.lock();
+    stamps.reserve( m_entries.count() );
+
+    for ( QMap<QString, Entry>::ConstIterator it = m_entries.begin(); it != m_entries.end(); ++it )
+    {
+        Stamp s;
+        s.path = QDeepCopy<QString>( it.key() );
+        s.size = it.data().size;
+        s.mtime = it.data().mtime;
+        stamps.push_back( s );
+    }
+
+    m_mutex.unlock();
+
+    QValueList<int> stale;
+
+    for ( uint i = 0; i < stamps.count(); ++i )
+    {
+        if ( m_abortCompaction )
+            return;
+
+        uint size, mtime;
+
+        if ( !stamp( stamps[i].path, size, mtime ) || size != stamps[i].size || mtime != stamps[i].mtime )
+            stale.append( i );
+    }
+
+    QMutexLocker locker( &m_mutex );
+
+    for ( QValueList<int>::ConstIterator it = stale.begin(); it != stale.end(); ++it )
+    {
+        const Stamp &s = stamps[ *it ];
+        QMap<QString, Entry>::Iterator entry = m_entries.find( s.path );
+
+// the file may have been read again in the meantime
+        if ( entry != m_entries.end() && entry.data().size == s.size && entry.data().mtime == s.mtime )
+        {
+            m_entries.remove( entry );
+            m_dirty = true;
+        }
+    }
+
+    if ( m_entries.count() <= MAX_ENTRIES )
+        return;
+
+// least recently used entries go first
+    QValueVector<uint> used;
+    used.reserve( m_entries.count() );
+
+    for ( QMap<QString, Entry>::ConstIterator it = m_entries.begin(); it != m_entries.end(); ++it )
+        used.push_back( it.data().used );
+
+    qHeapSort( used );
+
+    uint excess = m_entries.count() - MAX_ENTRIES;
+    const uint threshold = used[ excess - 1 ];
+
+    for ( int pass = 0; pass < 2 && excess; ++pass )
+    {
+        QMap<QString, Entry>::Iterator it = m_entries.begin();
+
+        while ( it != m_entries.end() && excess )
+        {
+            const uint u = it.data().used;
+
+            if ( u < threshold || ( pass == 1 && u == threshold ) )
+            {
+                QMap<QString, Entry>::Iterator victim = it;
+                ++it;
+                m_entries.remove( victim );
+                --excess;
+            }
+            else
+                ++it;
+        }
+    }
+
+    m_dirty = true;
+}
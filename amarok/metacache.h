@@ -0,0 +1,81 @@
+/***************************************************************************
+                          metacache.h  -  description
+                             -------------------
+    begin                : Mit Mai 7 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef METACACHE_H
+#define METACACHE_H
+
+#include "metabundle.h"
+
+#include <qmap.h>
+#include <qmutex.h>
+#include <qstring.h>
+
+class MetaCacheCompactor;
+
+/**
+ * Persistent cache of track metadata, so tags are read only once per file
+ * and not on every start. Entries are keyed by path and only valid as long
+ * as size and mtime of the file match. find() and insert() may be called
+ * from any thread, read() only from the GUI thread.
+ * The cache is trimmed to MAX_ENTRIES, least recently used first, and
+ * entries of deleted or changed files are dropped, all in a background
+ * thread.
+ *@author mark
+ */
+
+class MetaCache
+{
+    public:
+        MetaCache( const QString &fileName );
+        ~MetaCache();
+
+        bool find( const QString &path, MetaBundle &bundle );
+        void insert( const QString &path, const MetaBundle &bundle );
+        bool read( const QString &path, MetaBundle &bundle );
+        void setGain( const QString &path, float gain, float peak );
+
+        void load();
+        void save();
+        void compact();
+
+    private:
+        friend class MetaCacheCompactor;
+
+        struct Entry
+        {
+            uint size;
+            uint mtime;
+            uint used;              // session of the last access, for LRU trimming
+            MetaBundle bundle;
+        };
+
+        static bool stamp( const QString &path, uint &size, uint &mtime );
+        static MetaBundle deepCopy( const MetaBundle &bundle );
+        static void readFileMetaInfo( const QString &path, MetaBundle &bundle );
+        void doCompact();
+
+// ATTRIBUTES ------
+        QString m_fileName;
+        QMutex m_mutex;
+        QMap<QString, Entry> m_entries;
+        uint m_session;
+        bool m_dirty;
+
+        MetaCacheCompactor *m_pCompactor;
+        bool m_abortCompaction;
+};
+#endif
@@ -0,0 +1,216 @@
+/***************************************************************************
+                          metafetcher.cpp  -  description
+                             -------------------
+    begin                : Die Mai 6 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "metafetcher.h"
+#include "metabundle.h"
+#include "metacache.h"
+#include "tagreader.h"
+
+#include <qapplication.h>
+#include <qdeepcopy.h>
+#include <qevent.h>
+#include <qmap.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qthread.h>
+#include <qvaluelist.h>
+
+#include <unistd.h>
+
+// posted to the fetcher when the result list gets its first entry
+static const int RESULTS_EVENT = QEvent::User + 100;
+// reading tags is mostly waiting for the disk, so a few threads more than CPUs don't hurt
+static const int MAX_THREADS = 4;
+
+
+MetaFetcherThread::MetaFetcherThread( MetaFetcher *fetcher ) :
+m_pFetcher( fetcher )
+{
+}
+
+
+
+void MetaFetcherThread::run()
+{
+    MetaFetcher::Job job;
+
+    while ( m_pFetcher->nextJob( job ) )
+    {
+        if ( m_pFetcher->m_pCache->find( job.m_location, job.m_bundle ) )
+            job.m_ok = true;
+        else
+        {
+            job.m_ok = TagReader::read( job.m_location, job.m_bundle );
+
+            if ( job.m_ok )
+                m_pFetcher->m_pCache->insert( job.m_location, job.m_bundle );
+        }
+
+        m_pFetcher->addResult( job );
+    }
+}
+
+
+
+MetaFetcher::MetaFetcher( MetaCache *cache, QObject *parent, const char *name ) : QObject( parent, name ),
+m_pCache( cache ),
+m_shutdown( false )
+{
+    const long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    const int threads = QMIN( QMAX( static_cast<int>( cpus ), 1 ) + 1, MAX_THREADS );
+
+    for ( int i = 0; i < threads; ++i )
+    {
+        MetaFetcherThread *thread = new MetaFetcherThread( this );
+        m_threads.append( thread );
+        thread->start();
+    }
+}
+
+
+
+MetaFetcher::~MetaFetcher()
+{
+    m_mutex.lock();
+    m_shutdown = true;
+    m_jobs.clear();
+    m_jobWait.wakeAll();
+    m_mutex.unlock();
+
+    for ( MetaFetcherThread *thread = m_threads.first(); thread; thread = m_threads.next() )
+    {
+        thread->wait();
+        delete thread;
+    }
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void MetaFetcher::queue( int row, const QString &location, bool urgent )
+{
+    Job job;
+    job.m_row = row;
+// QString's reference counting is not thread safe, the workers get a copy of their own
+    job.m_location = QDeepCopy<QString>( location );
+
+    m_busy[ location ]++;
+
+    m_mutex.lock();
+
+    if ( urgent )
+        m_jobs.prepend( job );
+    else
+        m_jobs.append( job );
+
+    m_jobWait.wakeOne();
+    m_mutex.unlock();
+}
+
+
+
+void MetaFetcher::clear()
+{
+    m_mutex.lock();
+
+    for ( QValueList<Job>::Iterator it = m_jobs.begin(); it != m_jobs.end(); ++it )
+    {
+        QMap<QString, int>::Iterator busy = m_busy.find( ( *it ).m_location );
+
+        if ( busy != m_busy.end() && --busy.data() == 0 )
+            m_busy.remove( busy );
+    }
+
+    m_jobs.clear();
+    m_mutex.unlock();
+}
+
+
+
+uint MetaFetcher::pending() const
+{
+    QMutexLocker locker( &m_mutex );
+    return m_jobs.count();
+}
+
+
+
+QValueList<MetaFetcher::Job> MetaFetcher::takeResults()
+{
+    m_mutex.lock();
+    QValueList<Job> results = m_results;
+    m_results.clear();
+    m_mutex.unlock();
+
+    for ( QValueList<Job>::Iterator it = results.begin(); it != results.end(); ++it )
+    {
+        QMap<QString, int>::Iterator busy = m_busy.find( ( *it ).m_location );
+
+        if ( busy != m_busy.end() && --busy.data() == 0 )
+            m_busy.remove( busy );
+    }
+
+    return results;
+}
+
+
+
+bool MetaFetcher::nextJob( Job &job )
+{
+    QMutexLocker locker( &m_mutex );
+
+    while ( m_jobs.isEmpty() && !m_shutdown )
+        m_jobWait.wait( &m_mutex );
+
+    if ( m_shutdown )
+        return false;
+
+    job = m_jobs.first();
+    m_jobs.remove( m_jobs.begin() );
+
+    return true;
+}
+
+
+
+void MetaFetcher::addResult( Job &job )
+{
+    m_mutex.lock();
+
+    const bool first = m_results.isEmpty();
+    m_results.append( job );
+
+// drop the worker's references while still locked, from now on the strings belong to the GUI thread
+    job = Job();
+    m_mutex.unlock();
+
+// one event per batch, everything finished until the GUI gets to it is delivered together
+    if ( first )
+        QApplication::postEvent( this, new QCustomEvent( RESULTS_EVENT ) );
+}
+
+
+
+void MetaFetcher::customEvent( QCustomEvent *e )
+{
+    if ( e->type() == RESULTS_EVENT )
+        emit resultsReady();
+}
+
+
+#include "metafetcher.moc"
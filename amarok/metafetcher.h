@@ -0,0 +1,110 @@
+/***************************************************************************
+                          metafetcher.h  -  description
+                             -------------------
+    begin                : Die Mai 6 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef METAFETCHER_H
+#define METAFETCHER_H
+
+#include "metabundle.h"
+
+#include <qmap.h>
+#include <qmutex.h>
+#include <qobject.h>
+#include <qptrlist.h>
+#include <qstring.h>
+#include <qthread.h>
+#include <qvaluelist.h>
+#include <qwaitcondition.h>
+
+class QCustomEvent;
+class MetaCache;
+class MetaFetcher;
+
+/**
+ * Worker thread of MetaFetcher. Takes jobs until the fetcher shuts down.
+ */
+
+class MetaFetcherThread : public QThread
+{
+    public:
+        MetaFetcherThread( MetaFetcher *fetcher );
+
+    protected:
+        void run();
+
+    private:
+        MetaFetcher *m_pFetcher;
+};
+
+
+
+/**
+ * Pool of threads reading tags from the MetaCache, or with TagReader on a
+ * cache miss, so the GUI never waits for the disk. Jobs are queued from the
+ * GUI thread, urgent ones (rows in the viewport) in front. Finished jobs are collected and announced with
+ * resultsReady() once per batch, the receiver fetches them with takeResults().
+ * All public methods must be called from the GUI thread.
+ *@author mark
+ */
+
+class MetaFetcher : public QObject
+{
+    Q_OBJECT
+    public:
+        class Job
+        {
+            public:
+                Job() : m_row( -1 ), m_ok( false ) {}
+
+// ATTRIBUTES ------
+                int m_row;              // row at the time of queueing, rows may have moved since
+                QString m_location;
+                MetaBundle m_bundle;
+                bool m_ok;              // false if TagReader doesn't know the format
+        };
+
+        MetaFetcher( MetaCache *cache, QObject *parent = 0, const char *name = 0 );
+        ~MetaFetcher();
+
+        void queue( int row, const QString &location, bool urgent );
+        void clear();
+        bool isQueued( const QString &location ) const { return m_busy.contains( location ); }
+        uint pending() const;
+        bool isIdle() const { return m_busy.isEmpty(); }
+        QValueList<Job> takeResults();
+
+    signals:
+        void resultsReady();
+
+    private:
+        friend class MetaFetcherThread;
+
+        void customEvent( QCustomEvent *e );
+        bool nextJob( Job &job );
+        void addResult( Job &job );
+
+// ATTRIBUTES ------
+        MetaCache *m_pCache;
+        mutable QMutex m_mutex;
+        QWaitCondition m_jobWait;
+        QValueList<Job> m_jobs;
+        QValueList<Job> m_results;
+        QPtrList<MetaFetcherThread> m_threads;
+        bool m_shutdown;
+
+        QMap<QString, int> m_busy;      // locations queued, in progress or not yet taken, GUI thread only
+};
+#endif
@@ -17,14 +17,21 @@
 
 #include "playerapp.h"
 #include "playerwidget.h"
+#include "playobjectcreator.h"
+#include "streamconnection.h"
 #include "browserwin.h"
 #include "browserwidget.h"
 #include "playlistwidget.h"
 #include "playlistitem.h"
+#include "playlistloader.h"
+#include "playlistmodel.h"
 #include "viswidget.h"
 #include "expandbutton.h"
 #include "Options1.h"
 #include "effectwidget.h"
+#include "metabundle.h"
+#include "metacache.h"
+#include "seekindex.h"
 #include "amarokarts/amarokarts.h"
 
 #include <vector>
@@ -40,6 +47,7 @@
 #include <kdirlister.h>
 #include <kfile.h>
 #include <kfiledialog.h>
+#include <kglobalsettings.h>
 #include <kfileitem.h>
 #include <kglobalaccel.h>
 #include <kiconloader.h>
@@ -48,6 +56,7 @@
 #include <klineedit.h>
 #include <klocale.h>
 #include <kmainwindow.h>
+#include <kmdcodec.h>
 #include <kmessagebox.h>
 #include <kmimetype.h>
 #include <krun.h>
@@ -69,15 +78,21 @@
 #include <arts/flowsystem.h>
 
 #include <arts/kartsdispatcher.h>
+#include <arts/kartsfloatwatch.h>
 #include <arts/kartswidget.h>
 #include <arts/kmedia2.h>
 #include <arts/kplayobjectfactory.h>
 #include <arts/soundserver.h>
 
 #include <qcheckbox.h>
+#include <qcombobox.h>
 #include <qdialog.h>
 #include <qdir.h>
+#include <qevent.h>
+#include <qfile.h>
 #include <qfileinfo.h>
+#include <qhbox.h>
+#include <qlabel.h>
 #include <qlayout.h>
 #include <qpainter.h>
 #include <qpalette.h>
@@ -86,17 +101,40 @@
 #include <qpushbutton.h>
 #include <qsize.h>
 #include <qslider.h>
+#include <qspinbox.h>
 #include <qstring.h>
 #include <qtimer.h>
+#include <qtextedit.h>
 #include <qtoolbutton.h>
 #include <qvaluelist.h>
 #include <qvbox.h>
 
 #include <fcntl.h>
+#include <math.h>
 #include <sys/ioctl.h>
 #include <sys/soundcard.h>
 #include <sys/wait.h>
 
+// gapless mode: seconds before the end of a track when the next one is prepared
+static const int PRELOAD_TIME = 5;
+// seconds before the end when we start watching for it closely
+static const int END_WATCH_TIME = 2;
+// how closely, in ms
+static const int END_WATCH_INTERVAL = 10;
+// ms between looks at the crossfader once a fade should be over
+static const int FADE_DONE_DELAY = 200;
+// seconds a track may take to load, connect and start playing before it's skipped
+static const int START_TIMEOUT = 15;
+// ms over which the MCOP calls of the polling code are counted for the debug output
+static const int MCOP_COUNT_PERIOD = 10000;
+// percent of a track that must have been heard for its loudness to be remembered
+static const int MIN_LOUDNESS_COVERAGE = 90;
+// ms the analyzer keeps running after the last frame was fetched
+static const int SCOPE_LEASE = 500;
+// ms between two frames of the scroller and the analyzer
+static const int ANIM_INTERVAL = 30;
+// analyzer frames held back beyond those covering the output latency, for a late timer
+static const uint SCOPE_FRAME_MARGIN = 8;
 
 PlayerApp::PlayerApp() : KUniqueApplication( true, true, false )
 {
@@ -111,12 +149,47 @@ PlayerApp::PlayerApp() : KUniqueApplication( true, true, false )
 
     m_pGlobalAccel = new KGlobalAccel( this );
 
+// must be there before the playlist, which starts reading tags right away
+    m_pMetaCache = new MetaCache( kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/" ) + "metacache" );
+    m_pMetaCache->load();
+    m_pMetaCache->compact();
+
     m_pPlayObject = NULL;
+    m_pNextPlayObject = NULL;
+    m_nextRow = -1;
+    m_nextSlot = 0;
+    m_playSlot = 0;
+    m_pFadingPlayObject = NULL;
+    m_fadingSlot = 0;
+    m_lengthMs = 0;
+    m_positionCorrection = 0;
+    m_loudnessComplete = false;
+    m_loudnessDeferred = false;
+    m_loudnessLeadIn = 0;
+    m_outputLatency = 0;
+    m_pStateWatch = NULL;
+    m_pPositionWatch = NULL;
+    m_pLengthWatch = NULL;
+    m_pEndedWatch = NULL;
+    m_watchSerial = 0;
+    m_mcopCalls = 0;
     m_bIsPlaying = false;
     m_bChangingSlider = false;
     m_pArtsDispatcher = NULL;
+    m_pPlayObjectCreator = NULL;
     m_pEffectWidget = NULL;
 
+// slotStop() uses these, so they come before anything that may fail and end up there
+// (the main timer is much too coarse to catch the end of a track in time)
+    m_pEndTimer = new QTimer( this );
+    connect( m_pEndTimer, SIGNAL( timeout() ), this, SLOT( slotEndTimer() ) );
+
+    m_pFadeTimer = new QTimer( this );
+    connect( m_pFadeTimer, SIGNAL( timeout() ), this, SLOT( slotFadeTimer() ) );
+
+    m_pStartTimer = new QTimer( this );
+    connect( m_pStartTimer, SIGNAL( timeout() ), this, SLOT( slotStartTimeout() ) );
+
     initArts();
     if ( !initScope() )
     {
@@ -137,7 +210,7 @@ PlayerApp::PlayerApp() : KUniqueApplication( true, true, false )
 
     m_pAnimTimer = new QTimer( this );
     connect( m_pAnimTimer, SIGNAL( timeout() ), this, SLOT( slotAnimTimer() ) );
-    m_pAnimTimer->start( 30 );
+    m_pAnimTimer->start( ANIM_INTERVAL );
 
     m_pPlayerWidget->show();
 
@@ -149,15 +222,37 @@ PlayerApp::PlayerApp() : KUniqueApplication( true, true, false )
 PlayerApp::~PlayerApp()
 {
     slotStop();
+    clearScopeFrames();
+
+// the loaders post to us when done, they must not outlive us
+    for ( SeekIndexLoader *loader = m_seekLoaders.first(); loader; loader = m_seekLoaders.next() )
+    {
+        loader->abort();
+        loader->wait();
+        delete loader;
+    }
 
     killTimers();
     saveConfig();
 
     delete m_pEffectWidget;
     delete m_pPlayerWidget;
+// the playlist's reader threads use the cache, so they have to go first
+    delete m_pBrowserWin;
+    delete m_pMetaCache;
 
     m_Scope = Amarok::WinSkinFFT::null();
     m_volumeControl = Arts::StereoVolumeControl::null();
+    m_crossFader = Amarok::CrossFader::null();
+
+    delete m_pStateWatch;
+    delete m_pPositionWatch;
+    delete m_pLengthWatch;
+    delete m_pEndedWatch;
+    m_monitor = Amarok::PlaybackMonitor::null();
+    m_loudnessMeter = Amarok::LoudnessMeter::null();
+    m_statusQuery = Amarok::StatusQuery::null();
+    delete m_pPlayObjectCreator;
     m_effectStack = Arts::StereoEffectStack::null();
     m_globalEffectStack = Arts::StereoEffectStack::null();
     m_amanPlay = Arts::Synth_AMAN_PLAY::null();
@@ -177,7 +272,7 @@ int PlayerApp::newInstance()
     if ( !playlistUrl.isEmpty() )         //playlist
     {
         slotClearPlaylist();
-        loadPlaylist( KCmdLineArgs::makeURL( playlistUrl ).path(), 0 );
+        loadPlaylist( KCmdLineArgs::makeURL( playlistUrl ).path(), -1 );
     }
 
     if ( args->count() > 0 )
@@ -186,10 +281,10 @@ int PlayerApp::newInstance()
         {
             for ( int i = 0; i < args->count(); i++ )
             {
-                if ( !loadPlaylist( args->url( i ), m_pBrowserWin->m_pPlaylistWidget->lastItem() ) )
+                if ( !loadPlaylist( args->url( i ), m_pBrowserWin->m_pPlaylistWidget->count() - 1 ) )
                 {
                     if ( m_pBrowserWin->isFileValid( args->url( i ) ) )
-                        m_pBrowserWin->m_pPlaylistWidget->addItem( (PlaylistItem*) 1, args->url( i ) );
+                        m_pBrowserWin->m_pPlaylistWidget->appendItem( args->url( i ) );
                 }
             }
         }
@@ -199,10 +294,10 @@ int PlayerApp::newInstance()
 
             for ( int i = 0; i < args->count(); i++ )
             {
-                if ( !loadPlaylist( args->url( i ), 0 ) )
+                if ( !loadPlaylist( args->url( i ), -1 ) )
                 {
                     if ( m_pBrowserWin->isFileValid( args->url( i ) ) )
-                        m_pBrowserWin->m_pPlaylistWidget->addItem( 0, args->url( i ) );
+                        m_pBrowserWin->m_pPlaylistWidget->addItem( -1, args->url( i ) );
                 }
             }
             slotPlay();
@@ -311,6 +406,14 @@ void PlayerApp::initArts()
         exit( 1 );
     }
 
+// the first sample is heard once it went through the server's buffer
+    m_outputLatency = static_cast<int>( m_Server.serverBufferTime() );
+    m_trackTimer.setOutputLatency( m_outputLatency );
+
+    m_pPlayObjectCreator = new PlayObjectCreator( m_Server, this );
+    connect( m_pPlayObjectCreator, SIGNAL( ready( KDE::PlayObject* ) ), this, SLOT( slotPlayObjectReady( KDE::PlayObject* ) ) );
+    connect( m_pPlayObjectCreator, SIGNAL( failed() ), this, SLOT( slotPlayObjectFailed() ) );
+
     m_amanPlay = Arts::DynamicCast( m_Server.createObject( "Arts::Synth_AMAN_PLAY" ) );
     m_amanPlay.title( "amarok" );
     m_amanPlay.autoRestoreID( "amarok" );
@@ -324,6 +427,61 @@ void PlayerApp::initArts()
     m_effectStack.start();
     long id = m_globalEffectStack.insertBottom( m_effectStack, "Effect Stack" );
 
+// all PlayObjects play into the crossfader, without it (old libamarokarts) straight into the effect stack
+    m_crossFader = Arts::DynamicCast( m_Server.createObject( "Amarok::CrossFader" ) );
+
+    if ( m_crossFader.isNull() )
+        kdDebug() << "Amarok::CrossFader not available, crossfading disabled." << endl;
+    else
+    {
+        m_crossFader.start();
+        Arts::connect( m_crossFader, std::string( "outleft" ), m_globalEffectStack, std::string( "inleft" ) );
+        Arts::connect( m_crossFader, std::string( "outright" ), m_globalEffectStack, std::string( "inright" ) );
+    }
+
+// when we do have to ask, everything comes in one round trip
+    m_statusQuery = Arts::DynamicCast( m_Server.createObject( "Amarok::StatusQuery" ) );
+
+    if ( m_statusQuery.isNull() )
+        kdDebug() << "Amarok::StatusQuery not available, asking the PlayObject one value at a time." << endl;
+
+    m_mcopTime.start();
+
+// artsd reports state, position and the end of a track, instead of us asking all the time
+    m_monitor = Arts::DynamicCast( m_Server.createObject( "Amarok::PlaybackMonitor" ) );
+
+    if ( m_monitor.isNull() )
+        kdDebug() << "Amarok::PlaybackMonitor not available, polling the PlayObject." << endl;
+    else
+    {
+        m_monitor.start();
+        m_globalEffectStack.insertBottom( m_monitor, "Playback Monitor" );
+
+        m_pStateWatch = new KArtsFloatWatch( m_monitor, "state_changed", this );
+        connect( m_pStateWatch, SIGNAL( valueChanged( float ) ), this, SLOT( slotStateChanged( float ) ) );
+        m_pPositionWatch = new KArtsFloatWatch( m_monitor, "position_changed", this );
+        connect( m_pPositionWatch, SIGNAL( valueChanged( float ) ), this, SLOT( slotPositionChanged( float ) ) );
+        m_pLengthWatch = new KArtsFloatWatch( m_monitor, "length_changed", this );
+        connect( m_pLengthWatch, SIGNAL( valueChanged( float ) ), this, SLOT( slotLengthChanged( float ) ) );
+        m_pEndedWatch = new KArtsFloatWatch( m_monitor, "ended_changed", this );
+        connect( m_pEndedWatch, SIGNAL( valueChanged( float ) ), this, SLOT( slotTrackEnded( float ) ) );
+    }
+
+// each track is measured while it plays, its gain is applied from the next time on, by the
+// CrossFader per input, so the fading track keeps its level
+    m_loudnessMeter = Arts::DynamicCast( m_Server.createObject( "Amarok::LoudnessMeter" ) );
+
+    if ( m_loudnessMeter.isNull() || m_crossFader.isNull() )
+    {
+        kdDebug() << "Amarok::LoudnessMeter not available, no replay gain." << endl;
+        m_loudnessMeter = Amarok::LoudnessMeter::null();
+    }
+    else
+    {
+        m_loudnessMeter.start();
+        m_globalEffectStack.insertBottom( m_loudnessMeter, "Loudness Meter" );
+    }
+
 // *** until here
 }
 
@@ -457,6 +615,7 @@ bool PlayerApp::initScope()
     }
 
     m_scopeActive = false;
+    m_scopePlaying = false;
     long id = m_globalEffectStack.insertBottom( m_Scope, "Analyzer" );
 
 //TEST
@@ -497,8 +656,8 @@ void PlayerApp::initBrowserWin()
     connect( m_pBrowserWin->m_pButtonPrev, SIGNAL( clicked() ),
         this, SLOT( slotPrev() ) );
 
-    connect( m_pBrowserWin->m_pPlaylistWidget, SIGNAL( doubleClicked( QListViewItem* ) ),
-        this, SLOT( slotItemDoubleClicked( QListViewItem* ) ) );
+    connect( m_pBrowserWin->m_pPlaylistWidget, SIGNAL( doubleClicked( int ) ),
+        this, SLOT( slotItemDoubleClicked( int ) ) );
 
     connect( m_pBrowserWin, SIGNAL( signalHide() ),
         this, SLOT( slotPlaylistHide() ) );
@@ -511,62 +670,28 @@ void PlayerApp::initBrowserWin()
 
 // METHODS --------------------------------------------------------------------------
 
-bool PlayerApp::loadPlaylist( KURL url, QListViewItem *destination )
+bool PlayerApp::loadPlaylist( KURL url, int after )
 {
-    bool success = false;
-    QString tmpFile;
-    PlaylistItem *pCurr = static_cast<PlaylistItem*>( destination );
-
-    if ( url.path().lower().endsWith( ".m3u" ) )
-    {
-        if ( url.isLocalFile() )
-            tmpFile = url.path();
-        else
-            KIO::NetAccess::download( url, tmpFile );
+    const QString path = url.path().lower();
+    PlaylistLoader::Format format;
 
-        QFile file( tmpFile );
-        if ( file.open( IO_ReadOnly ) )
-        {
-            QTextStream stream( &file );
+    if ( path.endsWith( ".m3u" ) )
+        format = PlaylistLoader::M3U;
+    else if ( path.endsWith( ".pls" ) )
+        format = PlaylistLoader::PLS;
+    else
+        return false;
 
-            while ( QString str = stream.readLine() )
-            {
-                if ( !str.startsWith( "#" ) )
-                {
-                    pCurr = m_pBrowserWin->m_pPlaylistWidget->addItem( pCurr, str );
-                }
-            }
-            file.close();
-            success = true;
-        }
-    }
-    if ( url.path().lower().endsWith( ".pls" ) )
-    {
-        if ( url.isLocalFile() )
-            tmpFile = url.path();
-        else
-            KIO::NetAccess::download( url, tmpFile );
+    QString tmpFile;
 
-        QFile file( tmpFile );
-        if ( file.open( IO_ReadOnly ) )
-        {
-            QTextStream stream( &file );
+    if ( url.isLocalFile() )
+        tmpFile = url.path();
+    else
+        KIO::NetAccess::download( url, tmpFile );
 
-            while ( QString str = stream.readLine() )
-            {
-                if ( str.startsWith( "File" ) )
-                {
-                    pCurr = m_pBrowserWin->m_pPlaylistWidget->addItem( pCurr, str.section( "=", -1 ) );
-                    str = stream.readLine();
+    PlaylistLoader loader( m_pBrowserWin->m_pPlaylistWidget, url );
+    bool success = loader.load( tmpFile, format, after );
 
-                    if ( str.startsWith( "Title" ) )
-                        pCurr->setText( 0, str.section( "=", -1 ) );
-                }
-            }
-            file.close();
-            success = true;
-        }
-    }
     KIO::NetAccess::removeTempFile( tmpFile );
     return success;
 }
@@ -580,19 +705,15 @@ void PlayerApp::saveM3u( QString fileName )
     if ( !file.open( IO_WriteOnly ) )
         return;
 
-    PlaylistItem* item = static_cast<PlaylistItem*>( m_pBrowserWin->m_pPlaylistWidget->firstChild() );
+    const PlaylistModel *pModel = m_pBrowserWin->m_pPlaylistWidget->model();
     QTextStream stream( &file );
     stream << "#EXTM3U\n";
 
-    while( item != NULL )
+// the model already stores paths for local files and URLs for everything else
+    for ( int i = 0; i < pModel->count(); ++i )
     {
-        if ( item->url().protocol() == "file" )
-            stream << item->url().path();
-        else
-            stream << item->url().url();
-
+        stream << pModel->track( i ).m_location;
         stream << "\n";
-        item = static_cast<PlaylistItem*>( item->nextSibling() );
     }
 
     file.close();
@@ -638,9 +759,21 @@ void PlayerApp::saveConfig()
     m_pConfig->writeEntry( "Time Display Remaining", m_optTimeDisplayRemaining );
     m_pConfig->writeEntry( "Repeat Track", m_optRepeatTrack );
     m_pConfig->writeEntry( "Repeat Playlist", m_optRepeatPlaylist );
+    m_pConfig->writeEntry( "Gapless Playback", m_optGapless );
+    m_pConfig->writeEntry( "Crossfade", m_optCrossfade );
+    m_pConfig->writeEntry( "Crossfade Length", m_optCrossfadeLength );
+    m_pConfig->writeEntry( "Crossfade Curve", m_optCrossfadeCurve );
+    m_pConfig->writeEntry( "Stream Buffer", m_optStreamBuffer );
+    m_pConfig->writeEntry( "Stream Prefetch", m_optStreamPrefetch );
+    m_pConfig->writeEntry( "Replay Gain", m_optReplayGain );
+    m_pConfig->writeEntry( "Log Track Changes", m_optLogTrackChanges );
     m_pConfig->writeEntry( "Show MetaInfo", m_optReadMetaInfo );
 
-    saveM3u( kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/" ) + "current.m3u" );
+    const QString dataDir = kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/" );
+
+    saveM3u( dataDir + "current.m3u" );
+    m_pBrowserWin->m_pPlaylistWidget->saveSnapshot( dataDir + "current.playlist" );
+    m_pMetaCache->save();
 }
 
 
@@ -664,6 +797,16 @@ void PlayerApp::readConfig()
     m_optTimeDisplayRemaining = m_pConfig->readBoolEntry( "Time Display Remaining", false );
     m_optRepeatTrack = m_pConfig->readBoolEntry( "Repeat Track", false );
     m_optRepeatPlaylist = m_pConfig->readBoolEntry( "Repeat Playlist", false );
+    m_optGapless = m_pConfig->readBoolEntry( "Gapless Playback", true );
+    m_optCrossfade = m_pConfig->readBoolEntry( "Crossfade", false );
+    m_optCrossfadeLength = m_pConfig->readNumEntry( "Crossfade Length", 3000 );
+    m_optCrossfadeCurve = m_pConfig->readNumEntry( "Crossfade Curve", Amarok::fadeEqualPower );
+    m_optStreamBuffer = m_pConfig->readNumEntry( "Stream Buffer", 256 );
+    m_optStreamPrefetch = m_pConfig->readNumEntry( "Stream Prefetch", 64 );
+    m_pPlayObjectCreator->setStreamBuffer( m_optStreamBuffer * 1024, m_optStreamPrefetch * 1024 );
+    m_optReplayGain = m_pConfig->readBoolEntry( "Replay Gain", true );
+    m_optLogTrackChanges = m_pConfig->readBoolEntry( "Log Track Changes", false );
+    m_trackTimer.setLogging( m_optLogTrackChanges );
     m_optReadMetaInfo = m_pConfig->readBoolEntry( "Show MetaInfo", false );
 
     m_Volume = m_pConfig->readNumEntry( "Master Volume", 50 );
@@ -687,7 +830,15 @@ void PlayerApp::readConfig()
     }
     
     slotClearPlaylist();
-    loadPlaylist( kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/" ) + "current.m3u", 0 );
+
+// the snapshot restores much faster, but it's only good as long as nobody edited current.m3u behind our back
+    const QString dataDir = kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/" );
+    QFileInfo snapshotInfo( dataDir + "current.playlist" );
+    QFileInfo m3uInfo( dataDir + "current.m3u" );
+
+    if ( !snapshotInfo.exists() || ( m3uInfo.exists() && m3uInfo.lastModified() > snapshotInfo.lastModified() ) ||
+         !m_pBrowserWin->m_pPlaylistWidget->restoreSnapshot( dataDir + "current.playlist" ) )
+        loadPlaylist( dataDir + "current.m3u", -1 );
 //    loadM3u( kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/" ) + "current.m3u" );
 
     m_pGlobalAccel->insert( "add", "Add Location", 0, CTRL+SHIFT+Key_A, 0, this, SLOT( slotAddLocation() ), true, true );
@@ -726,31 +877,86 @@ bool PlayerApp::queryClose()
 
 
 
-void PlayerApp::getTrackLength()
+Amarok::PlaybackStatus PlayerApp::playStatus( KDE::PlayObject *playObject )
+{
+    if ( !m_statusQuery.isNull() )
+    {
+        countCalls( 1 );
+        Amarok::PlaybackStatus status = m_statusQuery.status( playObject->object() );
+
+// what we played it from, known here without asking the server
+        status.stream = playObject->stream();
+
+        return status;
+    }
+
+    Amarok::PlaybackStatus status;
+
+    status.state = playObject->state();
+    status.currentTime = playObject->currentTime();
+    status.overallTime = playObject->overallTime();
+    status.stream = playObject->stream();
+    status.bufferFill = -1.0;
+    countCalls( 3 );
+
+    return status;
+}
+
+
+
+void PlayerApp::countCalls( int calls )
 {
-    PlaylistItem* item = static_cast<PlaylistItem*>( m_pBrowserWin->m_pPlaylistWidget->currentTrack() );
+    m_mcopCalls += calls;
 
-    if ( item == NULL )
+    const int elapsed = m_mcopTime.elapsed();
+
+    if ( elapsed < MCOP_COUNT_PERIOD )
         return;
+
+    kdDebug() << "MCOP calls per second while polling: " << m_mcopCalls * 1000.0 / elapsed << endl;
+
+    m_mcopCalls = 0;
+    m_mcopTime.restart();
+}
+
+
+
+void PlayerApp::getTrackLength( const Amarok::PlaybackStatus &status )
+{
                                                   // let aRts calculate length
-    Arts::poTime timeO( m_pPlayObject->overallTime() );
-    m_Length = timeO.seconds;
-    m_pPlayerWidget->m_pSlider->setMaxValue( static_cast<int>( timeO.seconds ) );
+    setLength( status.overallTime.seconds * 1000 + status.overallTime.ms );
+}
+
 
-    KFileMetaInfo metaInfo( item->url().path(), QString::null, KFileMetaInfo::Everything );
 
-    if ( metaInfo.isValid() && !metaInfo.isEmpty() )
+void PlayerApp::setLength( long ms )
+{
+    int row = m_pBrowserWin->m_pPlaylistWidget->currentTrack();
+
+    if ( row == -1 )
+        return;
+
+// the decoder only estimates the length of a VBR file, the index has counted the frames
+    if ( !m_seekIndex.isEmpty() )
+        ms = m_seekIndex.length();
+
+    const PlaylistModel *pModel = m_pBrowserWin->m_pPlaylistWidget->model();
+    m_Length = ms / 1000;
+    m_lengthMs = ms;
+    m_pPlayerWidget->m_pSlider->setMaxValue( static_cast<int>( m_Length ) );
+
+    const MetaBundle bundle = m_pBrowserWin->m_pPlaylistWidget->metaInfo( row );
+
+    if ( !bundle.isEmpty() )
     {
         QString str, strNum;
-        if ( metaInfo.item( "Artist" ).string() == "---" ||
-            metaInfo.item( "Title" ).string() == "---" )
+        if ( bundle.m_title.isEmpty() )
         {
-            str.append( item->text( 0 ) + " (" );
+            str.append( pModel->text( row ) + " (" );
         }
         else
         {
-            str.append( metaInfo.item( "Artist" ).string() + " - ");
-            str.append( metaInfo.item( "Title" ).string() + " (" );
+            str.append( bundle.prettyTitle() + " (" );
         }
 
         int totSeconds, totMinutes, totHours;
@@ -767,268 +973,867 @@ void PlayerApp::getTrackLength()
         str.append( convertDigit( totSeconds ) + ")" );
 
         m_pPlayerWidget->setScroll( str,
-            metaInfo.item( "Bitrate" ).string(),
-            metaInfo.item( "Sample Rate" ).string() );
+            bundle.m_bitrate > 0 ? QString::number( bundle.m_bitrate ) + " kbps" : QString( " ? " ),
+            bundle.m_sampleRate > 0 ? QString::number( bundle.m_sampleRate ) + " Hz" : QString( " ? " ) );
     }
     else
     {
         QString str( m_pPlayObject->mediaName() );
 
         if ( str.isEmpty() )
-            m_pPlayerWidget->setScroll( item->text( 0 ), " ? ", " ? " );
+            m_pPlayerWidget->setScroll( pModel->text( row ), " ? ", " ? " );
         else
             m_pPlayerWidget->setScroll( str, " ? ", " ? " );
     }
-}
 
+    m_trackTimer.mark( TrackTimer::phaseTitle );
+}
 
 
-// SLOTS -----------------------------------------------------------------
 
-void PlayerApp::slotPrev()
+void PlayerApp::updatePosition( long ms )
 {
-// do nothing when list is empty
-    if ( m_pBrowserWin->m_pPlaylistWidget->childCount() == 0 )
+    ms += m_positionCorrection;
+
+    if ( !m_bSliderIsPressed )
     {
-        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( NULL );
-        return;
+        m_pPlayerWidget->m_pSlider->setValue( static_cast<int>( ms / 1000 ) );
+        updateTimeDisplay();
     }
 
-    QListViewItem *pItem = m_pBrowserWin->m_pPlaylistWidget->currentTrack();
-
-    if ( pItem == NULL )
-        return;
-
-    pItem = pItem->itemAbove();
-
-    if ( pItem != NULL )
+    if ( ( m_optGapless || m_optCrossfade ) && m_lengthMs > 0 && !m_pPlayObject->stream() )
     {
-        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( pItem );
-        m_pBrowserWin->m_pPlaylistWidget->unglowItems();
-        m_pBrowserWin->m_pPlaylistWidget->ensureItemVisible( pItem );
+        const long fadeLength = ( m_optCrossfade && !m_crossFader.isNull() ) ? m_optCrossfadeLength : 0;
+        const long remaining = m_lengthMs - ms;
 
-        if ( m_bIsPlaying )
+// the decoder gets PRELOAD_TIME to start up before the fade needs it
+        if ( remaining <= PRELOAD_TIME * 1000 + fadeLength && m_nextRow == -1 )
+            prepareNext();
+
+        if ( m_pNextPlayObject && fadeLength > 0 && m_nextSlot != m_playSlot )
         {
-            slotPlay();
+            if ( remaining <= fadeLength )
+                startCrossfade();
+// the monitor reports once a second, a timer hits the start of the fade in between
+            else if ( !m_monitor.isNull() )
+                m_pFadeTimer->start( remaining - fadeLength, true );
         }
+// the monitor reports the end itself, when polling we have to look closely
+        else if ( m_monitor.isNull() && remaining <= END_WATCH_TIME * 1000 && m_pNextPlayObject && !m_pEndTimer->isActive() )
+            m_pEndTimer->start( END_WATCH_INTERVAL );
     }
 }
 
 
 
-void PlayerApp::slotPlay()
+void PlayerApp::updateTimeDisplay()
 {
-    PlaylistItem* item = static_cast<PlaylistItem*>( m_pBrowserWin->m_pPlaylistWidget->currentTrack() );
-
-    if ( item == NULL )
+    if ( m_pPlayerWidget->isVisible() )
     {
-        item = static_cast<PlaylistItem*>( m_pBrowserWin->m_pPlaylistWidget->firstChild() );
-        PlaylistItem *tmpItem = item;
-
-        if ( !tmpItem )
-            return;
-
-        while ( tmpItem )
+        if ( m_optTimeDisplayRemaining )
         {
-            if ( tmpItem->isSelected() )
-                break;
-            tmpItem = static_cast<PlaylistItem*>( tmpItem->nextSibling() );
+            int sliderSeconds = m_Length - m_pPlayerWidget->m_pSlider->value();
+            m_pPlayerWidget->timeDisplay( true, sliderSeconds / 60 / 60 % 60, sliderSeconds / 60 % 60, sliderSeconds % 60 );
+        }
+        else
+        {
+            int sliderSeconds = m_pPlayerWidget->m_pSlider->value();
+            m_pPlayerWidget->timeDisplay( false, sliderSeconds / 60 / 60 % 60, sliderSeconds / 60 % 60, sliderSeconds % 60 );
         }
-        if ( tmpItem )                            //skip to the first selected item
-            item = tmpItem;
     }
+}
 
-    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( item );
 
-    if ( m_bIsPlaying )
-    {
-        slotStop();
-    }
 
-    m_Length = 0;
-    KDE::PlayObjectFactory factory( m_Server );
-    factory.setAllowStreaming( true );
-    m_pPlayObject = NULL;
-                                                  //second parameter: create BUS(true/false)
-    m_pPlayObject = factory.createPlayObject( item->url(), false );
-    m_bIsPlaying = true;
+void PlayerApp::trackEnded()
+{
+    m_trackTimer.setCause( TrackTimer::causeAuto );
 
-    if ( m_pPlayObject == NULL )
+    if ( m_pNextPlayObject )
+        switchToNext();
+// the end of the playlist: the PlaybackMonitor reports it only once, nobody asks again later
+    else if ( nextTrack() == -1 )
     {
-        kdDebug() << "Can't initialize Playobject. m_pPlayObject == NULL." << endl;
-        slotNext();
-        return;
+        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( -1 );
+        slotStop();
     }
-    if ( m_pPlayObject->isNull() )
-    {
-        kdDebug() << "Can't initialize Playobject. m_pPlayObject->isNull()." << endl;
-        delete m_pPlayObject;
-        m_pPlayObject = NULL;
+    else
         slotNext();
+
+// no change followed to take the cause
+    m_trackTimer.clearCause();
+}
+
+
+
+void PlayerApp::watchPlayObject( KDE::PlayObject *playObject )
+{
+    if ( m_monitor.isNull() )
         return;
-    }
 
-    if ( m_pPlayObject->object().isNull() )
-        connect( m_pPlayObject, SIGNAL( playObjectCreated() ), this, SLOT( slotConnectPlayObj() ) );
+    ++m_watchSerial;
+
+    if ( playObject && !playObject->object().isNull() )
+        m_monitor.watch( playObject->object(), m_watchSerial );
     else
-        slotConnectPlayObj();
+        m_monitor.watch( Arts::PlayObject::null(), m_watchSerial );
+}
 
-    m_pPlayObject->play();
 
-    m_pBrowserWin->m_pPlaylistWidget->unglowItems();
-    m_pBrowserWin->m_pPlaylistWidget->ensureItemVisible( item );
 
-    if ( m_pPlayObject->stream() )
-    {
-        m_Length = 0;
-        m_pPlayerWidget->m_pSlider->setMaxValue( 0 );
-        m_pPlayerWidget->timeDisplay( false, 0, 0, 0 );
+void PlayerApp::trackStarted()
+{
+    m_pStartTimer->stop();
+    m_playRetryCounter = 0;
+    m_trackTimer.mark( TrackTimer::phaseStart );
 
-        m_pPlayerWidget->setScroll( "Stream from: " + item->text( 0 ), "--", "--" );
-    }
+// streams have no length to wait for, their title is up already
+    if ( m_pPlayObject && m_pPlayObject->stream() )
+        m_trackTimer.mark( TrackTimer::phaseTitle );
+}
 
-    m_pPlayerWidget->m_pSlider->setValue( 0 );
-    m_pPlayerWidget->m_pSlider->setMinValue( 0 );
 
-    m_pPlayerWidget->m_pButtonPause->setDown( false );
+
+void PlayerApp::setScopePlaying( bool playing )
+{
+    m_scopePlaying = playing;
+
+// started again by slotAnimTimer() as soon as it wants a frame
+    if ( !playing || m_scopeLease.isNull() || m_scopeLease.elapsed() <= SCOPE_LEASE )
+        setScopeActive( playing );
 }
 
 
 
-void PlayerApp::slotConnectPlayObj()
+void PlayerApp::setScopeActive( bool active )
 {
-    if ( !m_pPlayObject->object().isNull() )
+    if ( active == m_scopeActive )
+        return;
+
+    if ( active )
+        m_Scope.start();
+    else
     {
-        m_pPlayObject->object()._node()->start();
-        
-        Arts::connect( m_pPlayObject->object(), std::string( "left" ), m_globalEffectStack, std::string( "inleft" ) );
-        Arts::connect( m_pPlayObject->object(), std::string( "right" ), m_globalEffectStack, std::string( "inright" ) );
+        m_Scope.stop();
+        clearScopeFrames();
     }
+
+    m_scopeActive = active;
 }
 
 
 
-void PlayerApp::slotPause()
+void PlayerApp::clearScopeFrames()
 {
-    if ( m_bIsPlaying && m_pPlayObject != NULL )
-    {
-        if ( m_pPlayObject->state() == Arts::posPaused )
-        {
-            m_pPlayObject->play();
-            m_pPlayerWidget->m_pButtonPause->setDown( false );
-        }
-        else
-        {
-            m_pPlayObject->pause();
-            m_pPlayerWidget->m_pButtonPause->setDown( true );
-        }
-    }
+    for ( QValueList<ScopeFrame>::Iterator it = m_scopeFrames.begin(); it != m_scopeFrames.end(); ++it )
+        delete ( *it ).m_pData;
+
+    m_scopeFrames.clear();
 }
 
 
 
-void PlayerApp::slotStop()
+int PlayerApp::nextTrack() const
 {
-    if ( m_bIsPlaying )
-    {
-        if ( m_pPlayObject )
-        {
-            m_pPlayObject->halt();
+    const PlaylistWidget *pPlaylist = m_pBrowserWin->m_pPlaylistWidget;
+    int row = pPlaylist->currentTrack();
 
-            Arts::disconnect( m_pPlayObject->object(), std::string( "left" ), m_globalEffectStack, std::string( "inleft" ) );
-            Arts::disconnect( m_pPlayObject->object(), std::string( "right" ), m_globalEffectStack, std::string( "inright" ) );
-            m_pPlayObject->object()._node()->stop();
+    if ( row == -1 )
+        return -1;
 
-            delete m_pPlayObject;
-            m_pPlayObject = NULL;
-        }
+    if ( !m_optRepeatTrack )
+        ++row;
 
-        m_bIsPlaying = false;
-        m_Length = 0;
-        m_pPlayerWidget->m_pButtonPause->setDown( false );
-        m_pPlayerWidget->m_pSlider->setValue( 0 );
-        m_pPlayerWidget->m_pSlider->setMinValue( 0 );
-        m_pPlayerWidget->m_pSlider->setMaxValue( 0 );
-        m_pPlayerWidget->setScroll( "no file loaded", " ", " " );
-        m_pPlayerWidget->timeDisplay( false, 0, 0, 0 );
+    if ( row >= pPlaylist->count() )
+    {
+        if ( pPlaylist->count() == 0 || !m_optRepeatPlaylist )
+            return -1;
 
-        delete m_pPlayerWidget->m_pPlayObjConfigWidget;
-        m_pPlayerWidget->m_pPlayObjConfigWidget = NULL;
+        row = 0;
     }
+
+    return row;
 }
 
 
 
-void PlayerApp::slotNext()
+KDE::PlayObject *PlayerApp::createPlayObject( const KURL &url )
 {
-   QListViewItem *pItem = m_pBrowserWin->m_pPlaylistWidget->currentTrack();
+    QTime time;
+    time.start();
+
+    KDE::PlayObject *playObject = m_pPlayObjectCreator->create( url );
 
-    if ( pItem == NULL )
+    kdDebug() << "PlayObject for " << url.prettyURL() << " created in " << time.elapsed() << " ms" << endl;
+
+    if ( playObject == NULL )
     {
-        slotStop();
-        return;
+        kdDebug() << "Can't initialize Playobject. m_pPlayObject == NULL." << endl;
+        return NULL;
+    }
+    if ( playObject->isNull() )
+    {
+        kdDebug() << "Can't initialize Playobject. m_pPlayObject->isNull()." << endl;
+        delete playObject;
+        return NULL;
     }
 
-    if ( !m_optRepeatTrack )
-        pItem = pItem->nextSibling();
+    return playObject;
+}
+
 
-    if ( pItem == NULL )
+
+void PlayerApp::connectPlayObject( KDE::PlayObject *playObject, int slot )
+{
+    if ( !playObject->object().isNull() )
     {
-        //do nothing when list is empty
-        if ( m_pBrowserWin->m_pPlaylistWidget->childCount() == 0 || !m_optRepeatPlaylist )
+        playObject->object()._node()->start();
+
+        if ( m_crossFader.isNull() )
         {
-            m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( NULL );
-            return;
+            Arts::connect( playObject->object(), std::string( "left" ), m_globalEffectStack, std::string( "inleft" ) );
+            Arts::connect( playObject->object(), std::string( "right" ), m_globalEffectStack, std::string( "inright" ) );
         }
         else
         {
-            pItem = m_pBrowserWin->m_pPlaylistWidget->firstChild();
+            Arts::connect( playObject->object(), std::string( "left" ), m_crossFader, std::string( slot ? "inleft2" : "inleft" ) );
+            Arts::connect( playObject->object(), std::string( "right" ), m_crossFader, std::string( slot ? "inright2" : "inright" ) );
         }
     }
+}
 
-    if ( pItem != NULL )
-    {
-        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( pItem );
-        m_pBrowserWin->m_pPlaylistWidget->unglowItems();
-        m_pBrowserWin->m_pPlaylistWidget->ensureItemVisible( pItem );
 
-        if ( m_bIsPlaying )
-        {
-            slotPlay();
-        }
+
+void PlayerApp::disconnectPlayObject( KDE::PlayObject *playObject, int slot )
+{
+    if ( m_crossFader.isNull() )
+    {
+        Arts::disconnect( playObject->object(), std::string( "left" ), m_globalEffectStack, std::string( "inleft" ) );
+        Arts::disconnect( playObject->object(), std::string( "right" ), m_globalEffectStack, std::string( "inright" ) );
+    }
+    else
+    {
+        Arts::disconnect( playObject->object(), std::string( "left" ), m_crossFader, std::string( slot ? "inleft2" : "inleft" ) );
+        Arts::disconnect( playObject->object(), std::string( "right" ), m_crossFader, std::string( slot ? "inright2" : "inright" ) );
     }
+
+    playObject->object()._node()->stop();
 }
 
 
 
-void PlayerApp::slotLoadPlaylist()
+void PlayerApp::prepareNext()
 {
-    KURLRequesterDlg dlg( QString::null, 0, 0 );
-    dlg.setCaption( makeStdCaption( "Enter file or URL" ) );
-    dlg.setIcon( icon() );
-    dlg.fileDialog()->setFilter( "*.m3u *.pls *.M3U *.PLS|Playlist Files" );
-    dlg.urlRequester()->setMode( KFile::File | KFile::ExistingOnly );
-    dlg.exec();
+    const int row = nextTrack();
 
-    KURL url = dlg.selectedURL();
+    if ( row == -1 )
+        return;
 
-    if ( !url.isEmpty() && url.isValid() )
+// tried once per track, even if it fails
+    m_nextRow = row;
+    const KURL url = m_pBrowserWin->m_pPlaylistWidget->model()->url( row );
+
+// streams may take seconds to connect, they don't profit from this anyway
+    if ( !url.isLocalFile() )
+        return;
+
+    KDE::PlayObject *playObject = createPlayObject( url );
+
+    if ( playObject == NULL )
+        return;
+
+// objects created asynchronously would be connected too late to help
+    if ( playObject->object().isNull() )
     {
-        slotClearPlaylist();
-        loadPlaylist( url, 0 );
+        delete playObject;
+        return;
     }
+
+// a crossfade needs the other input of the fader, for a gapless switch the same one does
+    m_nextSlot = ( m_optCrossfade && !m_crossFader.isNull() ) ? 1 - m_playSlot : m_playSlot;
+
+// connected and started, it delivers silence until play() is called
+    connectPlayObject( playObject, m_nextSlot );
+
+    m_pNextPlayObject = playObject;
+    m_nextUrl = url;
 }
 
 
 
-void PlayerApp::slotSavePlaylist()
+void PlayerApp::discardNext()
 {
-    QString path = KFileDialog::getSaveFileName( m_pBrowserWin->m_pBrowserWidget->m_pDirLister->url().path(), "*.m3u" );
+    m_pEndTimer->stop();
+    m_pFadeTimer->stop();
 
-    if ( !path.isEmpty() )
+    if ( m_pNextPlayObject )
     {
-        if ( path.right( 4 ) != ".m3u" )
-            path += ".m3u";
+        disconnectPlayObject( m_pNextPlayObject, m_nextSlot );
+        delete m_pNextPlayObject;
+        m_pNextPlayObject = NULL;
+    }
+
+    m_nextRow = -1;
+}
+
+
+
+void PlayerApp::switchToNext()
+{
+    const int row = m_nextRow;
+
+    m_trackTimer.setCause( TrackTimer::causeAuto );
+
+// the playlist or the repeat options may have changed since the track was prepared
+    if ( row != nextTrack() || m_pBrowserWin->m_pPlaylistWidget->model()->url( row ) != m_nextUrl )
+    {
+        discardNext();
+        slotNext();
+        m_trackTimer.clearCause();
+        return;
+    }
+
+// created and connected while the last track played, so those phases are left out
+    m_trackTimer.begin();
+
+    KDE::PlayObject *playObject = m_pNextPlayObject;
+    m_pNextPlayObject = NULL;
+    m_nextRow = -1;
+    m_pEndTimer->stop();
+    m_pFadeTimer->stop();
+
+// prepared for a crossfade that didn't happen, the fader switches over at once
+    if ( m_nextSlot != m_playSlot )
+    {
+        m_crossFader.fade();
+        m_crossFader.stopFade();
+    }
+
+// the old track is silent already, so start the new one before cleaning up
+    playObject->play();
+    m_trackTimer.mark( TrackTimer::phasePlay );
+
+    disconnectPlayObject( m_pPlayObject, m_playSlot );
+    delete m_pPlayObject;
+    m_trackTimer.mark( TrackTimer::phaseStop );
+    m_pPlayObject = playObject;
+    m_playSlot = m_nextSlot;
+    watchPlayObject( m_pPlayObject );
+
+    trackSwitched( row );
+}
+
+
+
+void PlayerApp::startCrossfade()
+{
+    const int row = m_nextRow;
+
+// try again with whatever comes next now, the current track keeps playing meanwhile
+    if ( row != nextTrack() || m_pBrowserWin->m_pPlaylistWidget->model()->url( row ) != m_nextUrl )
+    {
+        discardNext();
+        return;
+    }
+
+    m_trackTimer.setCause( TrackTimer::causeAuto );
+    m_trackTimer.begin();
+
+// only one fade at a time, a previous one still running is cut short
+    endCrossfade();
+    m_trackTimer.mark( TrackTimer::phaseStop );
+
+    m_pFadingPlayObject = m_pPlayObject;
+    m_fadingSlot = m_playSlot;
+
+    m_pPlayObject = m_pNextPlayObject;
+    m_playSlot = m_nextSlot;
+    m_pNextPlayObject = NULL;
+    m_nextRow = -1;
+    m_pEndTimer->stop();
+    m_pFadeTimer->stop();
+
+// the next track starts at gain 0, so its decoder has the whole fade to get going
+    m_pPlayObject->play();
+    m_trackTimer.mark( TrackTimer::phasePlay );
+    watchPlayObject( m_pPlayObject );
+
+    m_crossFader.duration( m_optCrossfadeLength / 1000.0 );
+    m_crossFader.curve( static_cast<Amarok::FadeCurve>( m_optCrossfadeCurve ) );
+    m_crossFader.fade();
+    QTimer::singleShot( m_optCrossfadeLength + FADE_DONE_DELAY, this, SLOT( slotFadeDone() ) );
+
+    trackSwitched( row );
+}
+
+
+
+void PlayerApp::endCrossfade()
+{
+    if ( m_pFadingPlayObject == NULL )
+        return;
+
+    m_crossFader.stopFade();
+
+    m_pFadingPlayObject->halt();
+    disconnectPlayObject( m_pFadingPlayObject, m_fadingSlot );
+    delete m_pFadingPlayObject;
+    m_pFadingPlayObject = NULL;
+
+// the meter sits behind the fader, only now it hears the current track alone
+    if ( m_loudnessDeferred )
+    {
+        measureLoudness( m_pBrowserWin->m_pPlaylistWidget->currentTrack() );
+        m_loudnessLeadIn = m_optCrossfadeLength;
+    }
+}
+
+
+
+void PlayerApp::trackSwitched( int row )
+{
+    delete m_pPlayerWidget->m_pPlayObjConfigWidget;
+    m_pPlayerWidget->m_pPlayObjConfigWidget = NULL;
+
+    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( row );
+    m_pBrowserWin->m_pPlaylistWidget->ensureTrackVisible( row );
+    measureLoudness( row );
+
+// getTrackLength() picks up the rest on the next tick of the main timer
+    m_Length = 0;
+    m_lengthMs = 0;
+    m_positionCorrection = 0;
+    m_pPlayerWidget->m_pSlider->setValue( 0 );
+    m_pPlayerWidget->m_pSlider->setMinValue( 0 );
+    m_pPlayerWidget->m_pButtonPause->setDown( false );
+
+// prepared ahead doesn't mean it will play
+    m_pStartTimer->start( START_TIMEOUT * 1000, true );
+
+    startSeekIndex( row );
+    m_trackTimer.mark( TrackTimer::phaseDisplay );
+}
+
+
+
+void PlayerApp::startSeekIndex( int row )
+{
+    const KURL url = m_pBrowserWin->m_pPlaylistWidget->model()->url( row );
+
+    if ( !url.isLocalFile() || !url.path().lower().endsWith( ".mp3" ) )
+    {
+        m_seekIndex.clear();
+        m_seekIndexPath = QString::null;
+        return;
+    }
+
+// played again, or switched to by gapless playback after we got it
+    if ( url.path() == m_seekIndexPath )
+        return;
+
+    m_seekIndex.clear();
+    m_seekIndexPath = url.path();
+
+// one cache file per path, size and mtime inside tell whether it's still good
+    const QString cacheFile = kapp->dirs()->saveLocation( "data", kapp->instanceName() + "/seekindex/" )
+                              + KMD5( QFile::encodeName( m_seekIndexPath ) ).hexDigest();
+
+    SeekIndexLoader *loader = new SeekIndexLoader( this, m_seekIndexPath, cacheFile );
+    m_seekLoaders.append( loader );
+    loader->start();
+}
+
+
+
+void PlayerApp::customEvent( QCustomEvent *e )
+{
+    if ( e->type() != SeekIndexLoader::EventType )
+        return;
+
+    SeekIndexLoader *loader = static_cast<SeekIndexLoader*>( e->data() );
+// posted at the very end of run(), this doesn't block for long
+    loader->wait();
+    m_seekLoaders.removeRef( loader );
+
+// the track may have changed while the file was scanned
+    if ( !loader->isAborted() && loader->path() == m_seekIndexPath && !loader->index().isEmpty() )
+    {
+        m_seekIndex = loader->index();
+        kdDebug() << "Seek index of " << m_seekIndexPath << ": " << m_seekIndex.length() << " ms" << endl;
+
+        if ( m_bIsPlaying && m_pPlayObject && !m_pPlayObject->stream() )
+            setLength( m_seekIndex.length() );
+    }
+
+    delete loader;
+}
+
+
+
+void PlayerApp::measureLoudness( int row )
+{
+    if ( m_loudnessMeter.isNull() )
+        return;
+
+    const KURL url = row == -1 ? KURL() : m_pBrowserWin->m_pPlaylistWidget->model()->url( row );
+    const bool fading = m_pFadingPlayObject != NULL;
+    const bool measure = !fading && url.isLocalFile() && m_pPlayObject && !m_pPlayObject->object().isNull() && !m_pPlayObject->stream();
+
+// ends the measurement of the track before, m_lengthMs still is its length
+    const Amarok::Loudness loudness = m_loudnessMeter.measure( measure ? m_pPlayObject->object() : Arts::PlayObject::null() );
+    countCalls( 1 );
+
+    if ( !m_loudnessPath.isEmpty() && loudness.seconds > 0 )
+    {
+        kdDebug() << "Loudness of " << m_loudnessPath << ": " << loudness.gain << " dB, peak " << loudness.peak
+                  << ", " << loudness.seconds << " s analyzed in " << static_cast<long>( loudness.cpuSeconds * 1000 ) << " ms" << endl;
+
+// crossfades cut the start and the end short, anything else that leaves out part of the track doesn't count
+        const long heard = static_cast<long>( loudness.seconds * 1000 ) + m_loudnessLeadIn + ( m_optCrossfade ? m_optCrossfadeLength : 0 );
+
+        if ( m_loudnessComplete && m_lengthMs > 0 && heard >= m_lengthMs * MIN_LOUDNESS_COVERAGE / 100 )
+            m_pMetaCache->setGain( m_loudnessPath, loudness.gain, loudness.peak );
+    }
+
+    m_loudnessPath = measure ? url.path() : QString::null;
+    m_loudnessComplete = measure;
+    m_loudnessDeferred = fading && row != -1;
+    m_loudnessLeadIn = 0;
+
+    applyGain( row );
+}
+
+
+
+void PlayerApp::applyGain( int row )
+{
+    if ( m_loudnessMeter.isNull() )
+        return;
+
+    float factor = 1.0;
+    MetaBundle bundle;
+
+    if ( m_optReplayGain && row != -1 )
+    {
+        const KURL url = m_pBrowserWin->m_pPlaylistWidget->model()->url( row );
+
+// tracks not measured yet play as they are
+        if ( url.isLocalFile() && m_pMetaCache->find( url.path(), bundle ) && bundle.m_peak >= 0.0 )
+        {
+            factor = pow( 10.0, bundle.m_gain / 20.0 );
+
+// louder, but not so loud that the peaks clip
+            if ( bundle.m_peak > 0.0 && factor * bundle.m_peak > 1.0 )
+                factor = 1.0 / bundle.m_peak;
+        }
+    }
+
+// during a crossfade that's the track coming in, the one going out keeps its gain
+    m_crossFader.setGain( m_playSlot, factor );
+    countCalls( 1 );
+}
+
+
+
+// SLOTS -----------------------------------------------------------------
+
+void PlayerApp::slotPrev()
+{
+// do nothing when list is empty
+    if ( m_pBrowserWin->m_pPlaylistWidget->count() == 0 )
+    {
+        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( -1 );
+        return;
+    }
+
+    int row = m_pBrowserWin->m_pPlaylistWidget->currentTrack();
+
+    if ( row == -1 )
+        return;
+
+    --row;
+
+    if ( row != -1 )
+    {
+        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( row );
+        m_pBrowserWin->m_pPlaylistWidget->ensureTrackVisible( row );
+
+        if ( m_bIsPlaying )
+        {
+            m_trackTimer.setCause( TrackTimer::causePrevious );
+            slotPlay();
+            m_trackTimer.clearCause();
+        }
+    }
+}
+
+
+
+void PlayerApp::slotPlay()
+{
+    const PlaylistModel *pModel = m_pBrowserWin->m_pPlaylistWidget->model();
+    int row = m_pBrowserWin->m_pPlaylistWidget->currentTrack();
+
+    if ( row == -1 )
+    {
+        if ( pModel->count() == 0 )
+            return;
+
+        row = pModel->firstSelected();            //skip to the first selected item
+
+        if ( row == -1 )
+            row = 0;
+    }
+
+    m_trackTimer.begin();
+    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( row );
+
+    if ( m_bIsPlaying )
+    {
+        slotStop();
+    }
+
+    m_trackTimer.mark( TrackTimer::phaseStop );
+    m_Length = 0;
+    m_lengthMs = 0;
+    m_positionCorrection = 0;
+    m_playSlot = m_crossFader.isNull() ? 0 : m_crossFader.active();
+    m_bIsPlaying = true;
+
+    const KURL url = pModel->url( row );
+
+// the GUI goes on while the file is read or the stream connects, slotPlayObjectReady() takes over then
+    m_pPlayerWidget->setScroll( ( url.isLocalFile() ? "Loading: " : "Connecting to: " ) + pModel->text( row ), "--", "--" );
+    m_pPlayerWidget->timeDisplay( false, 0, 0, 0 );
+    m_pPlayerWidget->m_pSlider->setMaxValue( 0 );
+    m_pPlayerWidget->m_pSlider->setValue( 0 );
+    m_pPlayerWidget->m_pSlider->setMinValue( 0 );
+    m_pPlayerWidget->m_pButtonPause->setDown( false );
+
+    m_pBrowserWin->m_pPlaylistWidget->ensureTrackVisible( row );
+    m_trackTimer.mark( TrackTimer::phaseDisplay );
+
+    m_pStartTimer->start( START_TIMEOUT * 1000, true );
+    m_pPlayObjectCreator->request( url );
+}
+
+
+
+void PlayerApp::slotPlayObjectReady( KDE::PlayObject *playObject )
+{
+// the start timer keeps running until trackStarted(), a decoder that never gets going is skipped
+// as well, the PlaybackMonitor only reports the end of a track that played
+    m_trackTimer.mark( TrackTimer::phaseCreate );
+
+    m_pPlayObject = playObject;
+    slotConnectPlayObj();
+    m_trackTimer.mark( TrackTimer::phaseConnect );
+    m_pPlayObject->play();
+    m_trackTimer.mark( TrackTimer::phasePlay );
+
+    startSeekIndex( m_pBrowserWin->m_pPlaylistWidget->currentTrack() );
+    measureLoudness( m_pBrowserWin->m_pPlaylistWidget->currentTrack() );
+
+    if ( m_pPlayObject->stream() )
+    {
+        m_Length = 0;
+        streamTitle();
+
+        StreamConnection *pConnection = StreamConnection::of( m_pPlayObject );
+
+        if ( pConnection )
+            connect( pConnection, SIGNAL( statusChanged() ), this, SLOT( slotStreamStatus() ) );
+    }
+}
+
+
+
+void PlayerApp::slotStreamStatus()
+{
+    if ( m_pPlayObject && sender() == StreamConnection::of( m_pPlayObject ) )
+        streamTitle();
+}
+
+
+
+void PlayerApp::streamTitle()
+{
+    const int row = m_pBrowserWin->m_pPlaylistWidget->currentTrack();
+    const QString title = m_pBrowserWin->m_pPlaylistWidget->model()->text( row );
+    const StreamConnection *pConnection = StreamConnection::of( m_pPlayObject );
+
+    if ( pConnection && pConnection->buffering() )
+        m_pPlayerWidget->setScroll( "Buffering: " + title, "--", "--" );
+    else
+        m_pPlayerWidget->setScroll( "Stream from: " + title, "--", "--" );
+}
+
+
+
+void PlayerApp::slotPlayObjectFailed()
+{
+    m_pStartTimer->stop();
+
+// each failure goes through the event loop once, so a list of dead entries is skipped one by one, not recursively
+    if ( ++m_playRetryCounter >= m_pBrowserWin->m_pPlaylistWidget->count() )
+    {
+        kdDebug() << "Nothing in the playlist can be played, giving up." << endl;
+        m_playRetryCounter = 0;
+        slotStop();
+        return;
+    }
+
+// the failed track was the last one, slotNext() would leave us in "Loading:" with nothing loading
+    if ( nextTrack() == -1 )
+    {
+        m_playRetryCounter = 0;
+        slotStop();
+        return;
+    }
+
+    m_trackTimer.setCause( TrackTimer::causeRetry );
+    slotNext();
+    m_trackTimer.clearCause();
+}
+
+
+
+void PlayerApp::slotStartTimeout()
+{
+    kdDebug() << "Track didn't start within " << START_TIMEOUT << " s, skipping it." << endl;
+
+    m_pPlayObjectCreator->cancel();
+    slotPlayObjectFailed();
+}
+
+
+
+void PlayerApp::slotConnectPlayObj()
+{
+    connectPlayObject( m_pPlayObject, m_playSlot );
+    watchPlayObject( m_pPlayObject );
+}
+
+
+
+void PlayerApp::slotPause()
+{
+// the fading track can't be paused along with the fade, so it's over right away
+    endCrossfade();
+
+    if ( m_bIsPlaying && m_pPlayObject != NULL )
+    {
+        if ( m_pPlayObject->state() == Arts::posPaused )
+        {
+            m_pPlayObject->play();
+            m_pPlayerWidget->m_pButtonPause->setDown( false );
+        }
+        else
+        {
+            m_pPlayObject->pause();
+            m_pPlayerWidget->m_pButtonPause->setDown( true );
+        }
+    }
+}
+
+
+
+void PlayerApp::slotStop()
+{
+// a track still loading or connecting is dropped as well
+    m_pStartTimer->stop();
+    m_pPlayObjectCreator->cancel();
+
+// no reports about a track we're about to stop
+    watchPlayObject( NULL );
+    measureLoudness( -1 );
+    discardNext();
+    endCrossfade();
+
+    if ( m_bIsPlaying )
+    {
+        if ( m_pPlayObject )
+        {
+            m_pPlayObject->halt();
+            disconnectPlayObject( m_pPlayObject, m_playSlot );
+
+            delete m_pPlayObject;
+            m_pPlayObject = NULL;
+        }
+
+        m_bIsPlaying = false;
+        m_Length = 0;
+        m_pPlayerWidget->m_pButtonPause->setDown( false );
+        m_pPlayerWidget->m_pSlider->setValue( 0 );
+        m_pPlayerWidget->m_pSlider->setMinValue( 0 );
+        m_pPlayerWidget->m_pSlider->setMaxValue( 0 );
+        m_pPlayerWidget->setScroll( "no file loaded", " ", " " );
+        m_pPlayerWidget->timeDisplay( false, 0, 0, 0 );
+
+        delete m_pPlayerWidget->m_pPlayObjConfigWidget;
+        m_pPlayerWidget->m_pPlayObjConfigWidget = NULL;
+    }
+}
+
+
+
+void PlayerApp::slotNext()
+{
+    if ( m_pBrowserWin->m_pPlaylistWidget->currentTrack() == -1 )
+    {
+        slotStop();
+        return;
+    }
+
+    const int row = nextTrack();
+
+    if ( row == -1 )
+    {
+        m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( -1 );
+        return;
+    }
+
+    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( row );
+    m_pBrowserWin->m_pPlaylistWidget->ensureTrackVisible( row );
+
+    if ( m_bIsPlaying )
+    {
+        m_trackTimer.setCause( TrackTimer::causeNext );
+        slotPlay();
+        m_trackTimer.clearCause();
+    }
+}
+
+
+
+void PlayerApp::slotLoadPlaylist()
+{
+    KURLRequesterDlg dlg( QString::null, 0, 0 );
+    dlg.setCaption( makeStdCaption( "Enter file or URL" ) );
+    dlg.setIcon( icon() );
+    dlg.fileDialog()->setFilter( "*.m3u *.pls *.M3U *.PLS|Playlist Files" );
+    dlg.urlRequester()->setMode( KFile::File | KFile::ExistingOnly );
+    dlg.exec();
+
+    KURL url = dlg.selectedURL();
+
+    if ( !url.isEmpty() && url.isValid() )
+    {
+        slotClearPlaylist();
+        loadPlaylist( url, -1 );
+    }
+}
+
+
+
+void PlayerApp::slotSavePlaylist()
+{
+    QString path = KFileDialog::getSaveFileName( m_pBrowserWin->m_pBrowserWidget->m_pDirLister->url().path(), "*.m3u" );
+
+    if ( !path.isEmpty() )
+    {
+        if ( path.right( 4 ) != ".m3u" )
+            path += ".m3u";
 
         saveM3u( path );
     }
@@ -1038,8 +1843,12 @@ void PlayerApp::slotSavePlaylist()
 
 void PlayerApp::slotClearPlaylist()
 {
+// a PlaylistLoader is inserting, it would go on with rows that don't exist anymore
+    if ( m_pBrowserWin->m_pPlaylistWidget->isLoading() )
+        return;
+
     m_pBrowserWin->m_pPlaylistWidget->clear();
-    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( NULL );
+    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( -1 );
     m_pBrowserWin->m_pPlaylistLineEdit->clear();
 }
 
@@ -1070,10 +1879,10 @@ void PlayerApp::slotAddLocation()
 
     if ( !url.isEmpty() && url.isValid() )
     {
-        if ( !loadPlaylist( url, 0 ) )
+        if ( !loadPlaylist( url, -1 ) )
         {
             if ( m_pBrowserWin->isFileValid( url ) )
-                new PlaylistItem( m_pBrowserWin->m_pPlaylistWidget, url );
+                m_pBrowserWin->m_pPlaylistWidget->addItem( -1, url );
         }
     }
 }
@@ -1089,18 +1898,44 @@ void PlayerApp::slotSliderPressed()
 
 void PlayerApp::slotSliderReleased()
 {
+    m_bSliderIsPressed = false;
+
     if ( m_bIsPlaying && m_pPlayObject != NULL )
     {
 
+        const long target = m_pPlayerWidget->m_pSlider->value() * 1000;
+        QTime seekTime;
+        seekTime.start();
+
         Arts::poTime time;
         time.ms = 0;
-        time.seconds = static_cast<long>( m_pPlayerWidget->m_pSlider->value() );
         time.custom = 0;
         time.customUnit = std::string();
+
+// the decoder goes to whole seconds by its own guess, the index knows which one lands closest
+        if ( m_seekIndex.isEmpty() || m_pPlayObject->stream() )
+        {
+            time.seconds = target / 1000;
+            m_positionCorrection = 0;
+        }
+        else
+            time.seconds = m_seekIndex.decoderSeek( target, m_positionCorrection );
+
         m_pPlayObject->seek(time);
-    }
+        m_loudnessComplete = false;
+        kdDebug() << "Seek to " << target << " ms: " << seekTime.elapsed() << " ms, off by " << m_positionCorrection << " ms" << endl;
 
-    m_bSliderIsPressed = false;
+// watching for the end starts again when it's near, the monitor reports the seek right away
+        m_pEndTimer->stop();
+        m_pFadeTimer->stop();
+
+// without it we'd show the old position until the next tick
+        if ( m_monitor.isNull() )
+        {
+            const Amarok::PlaybackStatus status = playStatus( m_pPlayObject );
+            updatePosition( status.currentTime.seconds * 1000 + status.currentTime.ms );
+        }
+    }
 }
 
 
@@ -1150,95 +1985,217 @@ void PlayerApp::slotMainTimer()
         m_pBrowserWin->m_pPlaylistWidget->fetchMetaInfo();
     }
 
-    if ( m_pPlayerWidget->isVisible() )
-    {
-        if ( m_optTimeDisplayRemaining )
-        {
-            int sliderSeconds = m_Length - m_pPlayerWidget->m_pSlider->value();
-            m_pPlayerWidget->timeDisplay( true, sliderSeconds / 60 / 60 % 60, sliderSeconds / 60 % 60, sliderSeconds % 60 );
-        }
-        else
-        {
-            int sliderSeconds = m_pPlayerWidget->m_pSlider->value();
-            m_pPlayerWidget->timeDisplay( false, sliderSeconds / 60 / 60 % 60, sliderSeconds / 60 % 60, sliderSeconds % 60 );
-        }
-    }
+// with the PlaybackMonitor, artsd tells us about everything below
+    if ( !m_monitor.isNull() )
+        return;
+
+    updateTimeDisplay();
+
+// the fader is done with the previous track
+    if ( m_pFadingPlayObject && !m_crossFader.fading() )
+        endCrossfade();
 
     if ( m_pPlayObject == NULL || m_pPlayObject->isNull() )
     {
-        if ( m_scopeActive )
-        {
-            m_Scope.stop();
-            m_scopeActive = false;
-        }
-
+        setScopePlaying( false );
         return;
     }
 
-    if ( ( m_Length == 0 ) && ( !m_pPlayObject->stream() ) )
-        getTrackLength();
+    if ( !m_bIsPlaying )
+        return;
+
+    const Amarok::PlaybackStatus status = playStatus( m_pPlayObject );
+
+    if ( ( m_Length == 0 ) && ( !status.stream ) )
+        getTrackLength( status );
 
     if ( m_bSliderIsPressed )
         return;
-    if ( !m_bIsPlaying )
-        return;
 
 // check if track has ended
-    if ( m_pPlayObject->state() == Arts::posIdle )
+    if ( status.state == Arts::posIdle )
     {
-        slotNext();
+        trackEnded();
         return;
     }
 
-    if ( m_pPlayObject->state() == Arts::posPlaying )
+    if ( status.state == Arts::posPlaying )
+        trackStarted();
+
+    setScopePlaying( status.state == Arts::posPlaying );
+
+    updatePosition( status.currentTime.seconds * 1000 + status.currentTime.ms );
+}
+
+
+
+void PlayerApp::slotEndTimer()
+{
+    if ( m_pPlayObject == NULL || m_pNextPlayObject == NULL )
     {
-        if ( !m_scopeActive )
-        {
-            m_Scope.start();
-            m_scopeActive = true;
-        }
+        m_pEndTimer->stop();
+        return;
     }
+
+    if ( m_bSliderIsPressed )
+        return;
+
+// after a seek back or while paused, it simply goes on looking
+    if ( playStatus( m_pPlayObject ).state == Arts::posIdle )
+        switchToNext();
+}
+
+
+
+void PlayerApp::slotFadeTimer()
+{
+    if ( m_bIsPlaying && m_pNextPlayObject && m_nextSlot != m_playSlot )
+        startCrossfade();
+}
+
+
+
+void PlayerApp::slotFadeDone()
+{
+    if ( m_pFadingPlayObject == NULL )
+        return;
+
+    if ( m_crossFader.fading() )
+        QTimer::singleShot( FADE_DONE_DELAY, this, SLOT( slotFadeDone() ) );
     else
-    {
-        if ( m_scopeActive )
-        {
-            m_Scope.stop();
-            m_scopeActive = false;
-        }
-    }
+        endCrossfade();
+}
 
-    Arts::poTime timeC(m_pPlayObject->currentTime() );
-    m_pPlayerWidget->m_pSlider->setValue( static_cast<int>( timeC.seconds ) );
+
+
+void PlayerApp::slotStateChanged( float state )
+{
+    const bool playing = static_cast<int>( state ) == Arts::posPlaying && m_bIsPlaying;
+
+    if ( playing )
+        trackStarted();
+    else
+// paused, no position reports until it goes on
+        m_pFadeTimer->stop();
+
+    setScopePlaying( playing );
+}
+
+
+
+void PlayerApp::slotPositionChanged( float seconds )
+{
+    if ( m_pPlayObject == NULL || !m_bIsPlaying )
+        return;
+
+    updatePosition( static_cast<long>( seconds * 1000 ) );
+}
+
+
+
+void PlayerApp::slotLengthChanged( float seconds )
+{
+    if ( m_pPlayObject == NULL || m_pPlayObject->stream() || seconds <= 0 )
+        return;
+
+    const long ms = static_cast<long>( seconds * 1000 );
+
+// the index has the exact length already
+    if ( !m_seekIndex.isEmpty() )
+        return;
+
+// estimates for VBR files change a little all the time, the scroller only cares about whole seconds
+    if ( ms / 1000 != m_Length )
+        setLength( ms );
+    else
+        m_lengthMs = ms;
+}
+
+
+
+void PlayerApp::slotTrackEnded( float serial )
+{
+// a report about a PlayObject we've dropped in the meantime
+    if ( static_cast<long>( serial ) != m_watchSerial || !m_bIsPlaying )
+        return;
+
+    trackEnded();
 }
 
 
 
 void PlayerApp::slotAnimTimer()
 {
-    if ( m_pPlayerWidget->isVisible() )
+    if ( !m_pPlayerWidget->isVisible() || m_pPlayerWidget->isMinimized() )
+    {
+// nobody watches, once the lease is up artsd stops computing spectra for nothing
+        if ( m_scopeActive && m_scopeLease.elapsed() > SCOPE_LEASE )
+            setScopeActive( false );
+
+        return;
+    }
+
+    m_pPlayerWidget->drawScroll();
+
+    if ( m_scopePlaying && !m_scopeActive )
+    {
+// there's nothing to show before the next block went through
+        setScopeActive( true );
+        m_scopeLease.start();
+        m_pPlayerWidget->m_pVis->drawAnalyzer( NULL );
+    }
+    else if ( m_scopeActive )
     {
-        m_pPlayerWidget->drawScroll();
+        m_scopeLease.start();
+
+// the MCOP stub returns a new vector on every call, it's ours to delete
+        ScopeFrame frame;
+        frame.m_pData = m_Scope.scope();
+        frame.m_time.start();
+        countCalls( 1 );
+        m_scopeFrames.append( frame );
+
+// enough to span the whole latency, however big the server's buffer is
+        if ( m_scopeFrames.count() > m_outputLatency / ANIM_INTERVAL + SCOPE_FRAME_MARGIN )
+        {
+            delete m_scopeFrames.first().m_pData;
+            m_scopeFrames.remove( m_scopeFrames.begin() );
+        }
+
+// artsd analyzed the block it just processed, that's heard only once it went through the
+// server's buffer, so the newest frame that old is the one matching what we hear now
+        std::vector<float> *pScopeVector = NULL;
+
+        while ( !m_scopeFrames.isEmpty() && m_scopeFrames.first().m_time.elapsed() >= m_outputLatency )
+        {
+            delete pScopeVector;
+            pScopeVector = m_scopeFrames.first().m_pData;
+            m_scopeFrames.remove( m_scopeFrames.begin() );
+        }
 
-        if ( m_scopeActive )
+// none due yet, the last frame stays up
+        if ( pScopeVector )
         {
-            std::vector<float> *pScopeVector = m_Scope.scope();
-            
             if ( pScopeVector->size() != 0 )
                 m_pPlayerWidget->m_pVis->drawAnalyzer( pScopeVector );
             else
                 m_pPlayerWidget->m_pVis->drawAnalyzer( NULL );
+
+            delete pScopeVector;
         }
-        else
-            m_pPlayerWidget->m_pVis->drawAnalyzer( NULL );
     }
+    else
+        m_pPlayerWidget->m_pVis->drawAnalyzer( NULL );
 }
 
 
 
-void PlayerApp::slotItemDoubleClicked( QListViewItem *item )
+void PlayerApp::slotItemDoubleClicked( int row )
 {
-    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( static_cast<PlaylistItem*>( item ) );
+    m_pBrowserWin->m_pPlaylistWidget->setCurrentTrack( row );
+    m_trackTimer.setCause( TrackTimer::causeDoubleClick );
     slotPlay();
+    m_trackTimer.clearCause();
 }
 
 
@@ -1307,8 +2264,42 @@ void PlayerApp::slotShowOptions()
     if ( m_optDropMode == "NonRecursively" )
         opt1->comboBox1->setCurrentItem( 2 );
 
-//  frame = pDia->addVBoxPage( QString( "Sound" ) , QString( "Configure sound options" ),
-//                             iconLoader.loadIcon( "sound", KIcon::NoGroup, KIcon::SizeMedium ) );
+    QVBox *soundPage = pDia->addVBoxPage( QString( "Sound" ) , QString( "Configure sound options" ),
+                                          iconLoader.loadIcon( "sound", KIcon::NoGroup, KIcon::SizeMedium ) );
+
+    QCheckBox *crossfadeBox = new QCheckBox( "Crossfade between tracks", soundPage );
+    crossfadeBox->setChecked( m_optCrossfade );
+    crossfadeBox->setEnabled( !m_crossFader.isNull() );
+
+    QHBox *lengthBox = new QHBox( soundPage );
+    new QLabel( "Crossfade length (ms):", lengthBox );
+    QSpinBox *lengthSpin = new QSpinBox( 500, 15000, 500, lengthBox );
+    lengthSpin->setValue( m_optCrossfadeLength );
+
+    QHBox *curveBox = new QHBox( soundPage );
+    new QLabel( "Crossfade curve:", curveBox );
+    QComboBox *curveCombo = new QComboBox( curveBox );
+    curveCombo->insertItem( "Linear" );                 // same order as Amarok::FadeCurve
+    curveCombo->insertItem( "Equal Power" );
+    curveCombo->insertItem( "S-Curve" );
+    curveCombo->setCurrentItem( m_optCrossfadeCurve );
+
+    QCheckBox *gainBox = new QCheckBox( "Level tracks to the same loudness (replay gain)", soundPage );
+    gainBox->setChecked( m_optReplayGain );
+    gainBox->setEnabled( !m_loudnessMeter.isNull() );
+
+    QHBox *bufferBox = new QHBox( soundPage );
+    new QLabel( "Stream buffer (KB, 0 for none):", bufferBox );
+    QSpinBox *bufferSpin = new QSpinBox( 0, 4096, 32, bufferBox );
+    bufferSpin->setValue( m_optStreamBuffer );
+
+    QHBox *prefetchBox = new QHBox( soundPage );
+    new QLabel( "Buffer before playing (KB):", prefetchBox );
+    QSpinBox *prefetchSpin = new QSpinBox( 0, 4096, 16, prefetchBox );
+    prefetchSpin->setValue( m_optStreamPrefetch );
+
+// takes up the rest of the page, so the options stay together at the top
+    new QWidget( soundPage );
 
     pDia->resize( 500, 390 );
 
@@ -1346,6 +2337,15 @@ void PlayerApp::slotShowOptions()
                 m_optDropMode = "NonRecursively";
                 break;
         }
+
+        m_optCrossfade = crossfadeBox->isChecked();
+        m_optCrossfadeLength = lengthSpin->value();
+        m_optCrossfadeCurve = curveCombo->currentItem();
+        m_optReplayGain = gainBox->isChecked();
+        applyGain( m_bIsPlaying ? m_pBrowserWin->m_pPlaylistWidget->currentTrack() : -1 );
+        m_optStreamBuffer = bufferSpin->value();
+        m_optStreamPrefetch = QMIN( prefetchSpin->value(), m_optStreamBuffer );
+        m_pPlayObjectCreator->setStreamBuffer( m_optStreamBuffer * 1024, m_optStreamPrefetch * 1024 );
     }
     delete pDia;
 }
@@ -1373,6 +2373,25 @@ void PlayerApp::slotShowTip()
 
 
 
+void PlayerApp::slotShowTrackTimes()
+{
+    KDialogBase dia( KDialogBase::Plain, "Track Change Times", KDialogBase::Close, KDialogBase::Close );
+    QVBoxLayout *layout = new QVBoxLayout( dia.plainPage() );
+
+    QTextEdit *view = new QTextEdit( dia.plainPage() );
+    view->setTextFormat( Qt::PlainText );
+    view->setReadOnly( true );
+    view->setWordWrap( QTextEdit::NoWrap );
+    view->setFont( KGlobalSettings::fixedFont() );
+    view->setText( m_trackTimer.report() );
+    layout->addWidget( view );
+
+    dia.resize( 640, 420 );
+    dia.exec();
+}
+
+
+
 void PlayerApp::slotSetRepeatTrack()
 {
     int id = m_pPlayerWidget->m_IdRepeatTrack ;
@@ -1411,6 +2430,19 @@ void PlayerApp::slotSetRepeatPlaylist()
 
 
 
+void PlayerApp::slotSetGapless()
+{
+    int id = m_pPlayerWidget->m_IdGapless;
+
+    m_optGapless = !m_pPlayerWidget->m_pPopupMenu->isItemChecked( id );
+    m_pPlayerWidget->m_pPopupMenu->setItemChecked( id, m_optGapless );
+
+    if ( !m_optGapless )
+        discardNext();
+}
+
+
+
 void PlayerApp::slotShowHelp()
 {
     KApplication::KApp->invokeHelp( QString::null, "amarok" );
@@ -26,22 +26,32 @@
 
 
 #include "amarokarts/amarokarts.h"
+#include "seekindex.h"
+#include "tracktimer.h"
+
+#include <qdatetime.h>
+#include <qptrlist.h>
+#include <qvaluelist.h>
 
 #include <kglobalaccel.h>
 #include <kuniqueapplication.h>
+#include <kurl.h>
 #include <vector>
 #include <arts/kartsdispatcher.h>
 #include <arts/kplayobjectfactory.h>
 
+class QCustomEvent;
 class QListView;
-class QListViewItem;
 class QString;
 class QTimer;
 
+class KArtsFloatWatch;
 class KConfig;
 
 class BrowserWin;
 class EffectWidget;
+class MetaCache;
+class PlayObjectCreator;
 class PlaylistItem;
 class PlayerWidget;
 
@@ -57,7 +67,7 @@ class PlayerApp : public KUniqueApplication
         virtual ~PlayerApp();
 
         virtual int newInstance();
-        bool loadPlaylist( KURL url, QListViewItem *destination );
+        bool loadPlaylist( KURL url, int after );
         void saveM3u( QString fileName );
         bool queryClose();
 
@@ -66,12 +76,20 @@ class PlayerApp : public KUniqueApplication
 
         PlayerWidget *m_pPlayerWidget;
         BrowserWin *m_pBrowserWin;
+        MetaCache *m_pMetaCache;
 
         QColor m_bgColor;
         QColor m_fgColor;
 
         bool m_optSavePlaylist, m_optConfirmClear, m_optConfirmExit, m_optFollowSymlinks;
         bool m_optTimeDisplayRemaining, m_optReadMetaInfo, m_optRepeatTrack, m_optRepeatPlaylist;
+        bool m_optGapless, m_optCrossfade;
+        int m_optCrossfadeLength;       // ms
+        int m_optCrossfadeCurve;        // Amarok::FadeCurve
+        int m_optStreamBuffer;          // KB, 0 plays streams without it
+        int m_optStreamPrefetch;        // KB
+        bool m_optReplayGain;
+        bool m_optLogTrackChanges;
         QString m_optDropMode;
 
         int m_Volume;
@@ -84,6 +102,10 @@ class PlayerApp : public KUniqueApplication
         Arts::StereoEffectStack m_effectStack;
         Arts::StereoEffect *freeverb;
         Arts::StereoVolumeControl m_volumeControl;
+        Amarok::CrossFader m_crossFader;
+        Amarok::PlaybackMonitor m_monitor;
+        Amarok::LoudnessMeter m_loudnessMeter;
+        Amarok::StatusQuery m_statusQuery;
         Arts::Synth_AMAN_PLAY m_amanPlay;
 
     public slots:
@@ -104,7 +126,7 @@ class PlayerApp : public KUniqueApplication
         void slotVolumeChanged( int value );
         void slotMainTimer();
         void slotAnimTimer();
-        void slotItemDoubleClicked( QListViewItem *item );
+        void slotItemDoubleClicked( int row );
         void slotShowAbout();
         void slotPlaylistToggle( bool b );
         void slotPlaylistHide();
@@ -112,10 +134,25 @@ class PlayerApp : public KUniqueApplication
         void slotShowOptions();
         void slotConfigEffects();
         void slotShowTip();
+        void slotShowTrackTimes();
         void slotSetRepeatTrack();
         void slotSetRepeatPlaylist();
+        void slotSetGapless();
         void slotShowHelp();
 
+    private slots:
+        void slotEndTimer();
+        void slotPlayObjectReady( KDE::PlayObject *playObject );
+        void slotPlayObjectFailed();
+        void slotStartTimeout();
+        void slotStreamStatus();
+        void slotFadeTimer();
+        void slotFadeDone();
+        void slotStateChanged( float state );
+        void slotPositionChanged( float seconds );
+        void slotLengthChanged( float seconds );
+        void slotTrackEnded( float serial );
+
         signals:
         void sigScope( std::vector<float> *s );
         void sigPlay();
@@ -130,24 +167,92 @@ class PlayerApp : public KUniqueApplication
         void initColors();
         void saveConfig();
         void readConfig();
-        void getTrackLength();
+        Amarok::PlaybackStatus playStatus( KDE::PlayObject *playObject );
+        void countCalls( int calls );
+        void getTrackLength( const Amarok::PlaybackStatus &status );
+        void setLength( long ms );
+        void updatePosition( long ms );
+        void updateTimeDisplay();
+        void trackEnded();
+        void watchPlayObject( KDE::PlayObject *playObject );
+        int nextTrack() const;
+        KDE::PlayObject *createPlayObject( const KURL &url );
+        void connectPlayObject( KDE::PlayObject *playObject, int slot );
+        void disconnectPlayObject( KDE::PlayObject *playObject, int slot );
+        void prepareNext();
+        void discardNext();
+        void switchToNext();
+        void startCrossfade();
+        void endCrossfade();
+        void trackSwitched( int row );
+        void trackStarted();
+        void setScopePlaying( bool playing );
+        void setScopeActive( bool active );
+        void clearScopeFrames();
+        void startSeekIndex( int row );
+        void measureLoudness( int row );
+        void applyGain( int row );
+        void customEvent( QCustomEvent *e );
+        void streamTitle();
 
         QString convertDigit( const long &digit );
 
+        class ScopeFrame
+        {
+            public:
+// ATTRIBUTES ------
+                std::vector<float> *m_pData;
+                QTime m_time;                   // since it was fetched
+        };
+
 // ATTRIBUTES ------
         KArtsDispatcher *m_pArtsDispatcher;
+        PlayObjectCreator *m_pPlayObjectCreator;
         bool m_usingMixerHW;
         KConfig *m_pConfig;
         QTimer *m_pMainTimer;
         QTimer *m_pAnimTimer;
+        QTimer *m_pEndTimer;
+        QTimer *m_pFadeTimer;
+        QTimer *m_pStartTimer;
+
+        KArtsFloatWatch *m_pStateWatch;
+        KArtsFloatWatch *m_pPositionWatch;
+        KArtsFloatWatch *m_pLengthWatch;
+        KArtsFloatWatch *m_pEndedWatch;
+        long m_watchSerial;                     // tells the PlaybackMonitor's reports on different PlayObjects apart
+        int m_mcopCalls;                        // round trips to artsd since m_mcopTime
+        QTime m_mcopTime;
+        TrackTimer m_trackTimer;
         long m_scopeId;
-        bool m_scopeActive;
+        bool m_scopeActive;                     // m_Scope is started and computes spectra
+        bool m_scopePlaying;                    // there is something to analyze
+        QTime m_scopeLease;                     // since the last frame was fetched
+        QValueList<ScopeFrame> m_scopeFrames;   // fetched, but not heard yet
+        int m_outputLatency;                    // ms from artsd processing a block until it's heard
         long m_Length;
+        long m_lengthMs;
         int m_Mixer;
         int m_playRetryCounter;
+        SeekIndex m_seekIndex;                  // of the current track, empty if there's none (yet)
+        QString m_seekIndexPath;
+        long m_positionCorrection;              // ms the decoder's time is off after the last seek
+        QPtrList<SeekIndexLoader> m_seekLoaders;
+        QString m_loudnessPath;                 // local file the LoudnessMeter is measuring
+        bool m_loudnessComplete;                // false once part of the track was skipped
+        bool m_loudnessDeferred;                // the current track is measured once the crossfade is over
+        long m_loudnessLeadIn;                  // ms of the track played before it was measured
         EffectWidget *m_pEffectWidget;
 
         bool m_bIsPlaying;
         bool m_bChangingSlider;
+
+        int m_playSlot;                         // crossfader input of m_pPlayObject
+        KDE::PlayObject *m_pNextPlayObject;     // the following track, connected but not playing yet
+        int m_nextRow;
+        int m_nextSlot;
+        KURL m_nextUrl;
+        KDE::PlayObject *m_pFadingPlayObject;   // the previous track while it's faded out
+        int m_fadingSlot;
 };
 #endif                                            // KDETEST_H
@@ -179,7 +179,7 @@ void AmarokSlider::mousePressEvent( QMouseEvent *e )
     if ( orientation() == QSlider::Horizontal )
         newVal = static_cast<float>( e->x() ) / static_cast<float>( width() ) * maxValue();
     else
-        newVal = static_cast<float>( e->x() ) / static_cast<float>( height() ) * maxValue();
+        newVal = static_cast<float>( e->y() ) / static_cast<float>( height() ) * maxValue();
             
     int intVal = static_cast<int>( newVal );
             
@@ -188,6 +188,8 @@ void AmarokSlider::mousePressEvent( QMouseEvent *e )
         pApp->m_bSliderIsPressed = true;
         setValue( intVal );
         emit sliderReleased();
+// the click was the seek, passing it on would grab the handle now under the mouse and seek again on release
+        return;
     }
 
     QSlider::mousePressEvent( e );
@@ -553,11 +555,14 @@ void PlayerWidget::mousePressEvent( QMouseEvent *e )
 
             m_pPopupMenu->insertItem( "Effects", pApp, SLOT( slotConfigEffects() ) );
             m_IdConfPlayObject = m_pPopupMenu->insertItem( "Configure PlayObject", this, SLOT( slotConfigPlayObject() ) );
+            m_pPopupMenu->insertItem( "Track Change Times", pApp, SLOT( slotShowTrackTimes() ) );
 
             m_pPopupMenu->insertSeparator();
 
             m_IdRepeatTrack = m_pPopupMenu->insertItem( "Repeat Track", pApp, SLOT( slotSetRepeatTrack() ) );
             m_IdRepeatPlaylist = m_pPopupMenu->insertItem( "Repeat Playlist", pApp, SLOT( slotSetRepeatPlaylist() ) );
+            m_IdGapless = m_pPopupMenu->insertItem( "Gapless Playback", pApp, SLOT( slotSetGapless() ) );
+            m_pPopupMenu->setItemChecked( m_IdGapless, pApp->m_optGapless );
 
             m_pPopupMenu->insertSeparator();
 
@@ -622,12 +627,12 @@ void PlayerWidget::slotConfigGlobalShortcuts()
 
 void PlayerWidget::slotCopyClipboard()
 {
-    QListViewItem *currentTrack = pApp->m_pBrowserWin->m_pPlaylistWidget->currentTrack();
+    int currentTrack = pApp->m_pBrowserWin->m_pPlaylistWidget->currentTrack();
 
-    if ( currentTrack )
+    if ( currentTrack != -1 )
     {
         QClipboard *cb = QApplication::clipboard();
-        cb->setText( currentTrack->text( 0 ) );
+        cb->setText( pApp->m_pBrowserWin->m_pPlaylistWidget->model()->text( currentTrack ) );
     }
 }
 
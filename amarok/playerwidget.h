@@ -130,7 +130,7 @@ class PlayerWidget : public QWidget
         QLabel *m_pTimeDisplayLabel;
         AmarokButton *m_pButtonPl, *m_pButtonEq, *m_pButtonLogo;
         QPushButton *m_pButtonPrev, *m_pButtonPlay, *m_pButtonPause, *m_pButtonStop, *m_pButtonNext;
-        int m_IdRepeatTrack, m_IdRepeatPlaylist, m_IdConfPlayObject;
+        int m_IdRepeatTrack, m_IdRepeatPlaylist, m_IdGapless, m_IdConfPlayObject;
         ArtsConfigWidget *m_pPlayObjConfigWidget;
 
     public slots:
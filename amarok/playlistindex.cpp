@@ -0,0 +1,310 @@
+/***************************************************************************
+                          playlistindex.cpp  -  description
+                             -------------------
+    begin                : Mon Mai 5 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "playlistindex.h"
+#include "playlistmodel.h"
+
+#include <qmap.h>
+#include <qstring.h>
+#include <qvaluelist.h>
+#include <qvaluevector.h>
+
+// how many results we keep for going back with backspace
+static const uint MAX_RESULTS = 32;
+
+
+PlaylistIndex::PlaylistIndex( const PlaylistModel *model ) :
+m_pModel( model ),
+m_textsValid( false ),
+m_gramsValid( false )
+{
+}
+
+
+
+PlaylistIndex::~PlaylistIndex()
+{
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void PlaylistIndex::invalidate()
+{
+    if ( !m_textsValid && m_results.isEmpty() )
+        return;
+
+    m_texts.clear();
+    m_grams.clear();
+    m_results.clear();
+    m_textsValid = false;
+    m_gramsValid = false;
+}
+
+
+
+void PlaylistIndex::updateRow( int row )
+{
+// nothing built yet, match() reads the new title anyway
+    if ( !m_textsValid )
+        return;
+
+    const QString text = m_pModel->text( row ).lower();
+
+    if ( text == m_texts[row] )
+        return;
+
+    if ( m_gramsValid )
+    {
+        removeGrams( m_texts[row], row );
+        addGrams( text, row );
+    }
+
+    m_texts[row] = text;
+
+// the row may (dis)appear in any of the cached results, but only this row has to be checked
+    for ( QValueList<Result>::Iterator it = m_results.begin(); it != m_results.end(); ++it )
+    {
+        if ( text.find( ( *it ).query ) != -1 )
+            insertRow( ( *it ).rows, row );
+        else
+            removeRow( ( *it ).rows, row );
+    }
+}
+
+
+
+QValueVector<int> PlaylistIndex::match( const QString &text )
+{
+    const QString query = text.lower();
+
+    if ( !m_textsValid )
+        buildTexts();
+
+// drop all results that are not a prefix of the query, e.g. after backspace
+    while ( !m_results.isEmpty() && !query.startsWith( m_results.last().query ) )
+        m_results.pop_back();
+
+    if ( !m_results.isEmpty() && m_results.last().query == query )
+        return m_results.last().rows;
+
+    Result result;
+    result.query = query;
+    result.rows.reserve( m_results.isEmpty() ? m_texts.count() : m_results.last().rows.count() );
+
+    if ( !m_results.isEmpty() )
+    {
+// the query got longer, so only the current matches can still match
+        const QValueVector<int> &candidates = m_results.last().rows;
+
+        for ( uint i = 0; i < candidates.count(); ++i )
+            if ( m_texts[ candidates[i] ].find( query ) != -1 )
+                result.rows.push_back( candidates[i] );
+    }
+    else if ( query.length() >= 3 )
+    {
+        const QValueVector<int> candidates = gramCandidates( query );
+
+        for ( uint i = 0; i < candidates.count(); ++i )
+            if ( m_texts[ candidates[i] ].find( query ) != -1 )
+                result.rows.push_back( candidates[i] );
+    }
+    else
+    {
+        for ( uint i = 0; i < m_texts.count(); ++i )
+            if ( m_texts[i].find( query ) != -1 )
+                result.rows.push_back( i );
+    }
+
+    m_results.append( result );
+
+    if ( m_results.count() > MAX_RESULTS )
+        m_results.pop_front();
+
+    return result.rows;
+}
+
+
+
+void PlaylistIndex::buildTexts()
+{
+    const int count = m_pModel->count();
+
+    m_texts.resize( count );
+
+    for ( int i = 0; i < count; ++i )
+        m_texts[i] = m_pModel->text( i ).lower();
+
+    m_textsValid = true;
+}
+
+
+
+void PlaylistIndex::buildGrams()
+{
+    m_grams.clear();
+
+    for ( uint row = 0; row < m_texts.count(); ++row )
+    {
+        const QString &str = m_texts[row];
+
+        for ( int i = 0; i + 3 <= static_cast<int>( str.length() ); ++i )
+        {
+            QValueVector<int> &list = m_grams[ gramKey( str.unicode() + i ) ];
+
+// rows come in ascending order, so this keeps every list sorted and unique
+            if ( list.isEmpty() || list.back() != static_cast<int>( row ) )
+                list.push_back( row );
+        }
+    }
+
+    m_gramsValid = true;
+}
+
+
+
+void PlaylistIndex::addGrams( const QString &str, int row )
+{
+    for ( int i = 0; i + 3 <= static_cast<int>( str.length() ); ++i )
+        insertRow( m_grams[ gramKey( str.unicode() + i ) ], row );
+}
+
+
+
+void PlaylistIndex::removeGrams( const QString &str, int row )
+{
+    for ( int i = 0; i + 3 <= static_cast<int>( str.length() ); ++i )
+    {
+        QMap<uint, QValueVector<int> >::Iterator it = m_grams.find( gramKey( str.unicode() + i ) );
+
+        if ( it == m_grams.end() )
+            continue;
+
+        removeRow( it.data(), row );
+
+// gramCandidates() takes a missing key for "no match", an empty list would do the same
+        if ( it.data().isEmpty() )
+            m_grams.remove( it );
+    }
+}
+
+
+
+QValueVector<int> PlaylistIndex::gramCandidates( const QString &query )
+{
+    if ( !m_gramsValid )
+        buildGrams();
+
+    QValueVector<int> candidates;
+    bool first = true;
+
+    for ( int i = 0; i + 3 <= static_cast<int>( query.length() ); ++i )
+    {
+        QMap<uint, QValueVector<int> >::Iterator it = m_grams.find( gramKey( query.unicode() + i ) );
+
+        if ( it == m_grams.end() )
+            return QValueVector<int>();
+
+        candidates = first ? it.data() : intersect( candidates, it.data() );
+        first = false;
+
+        if ( candidates.isEmpty() )
+            break;
+    }
+
+    return candidates;
+}
+
+
+
+uint PlaylistIndex::gramKey( const QChar *c )
+{
+// collisions only cost us a few more candidates, they are verified anyway
+    return ( c[0].unicode() << 20 ) ^ ( c[1].unicode() << 10 ) ^ c[2].unicode();
+}
+
+
+
+void PlaylistIndex::insertRow( QValueVector<int> &rows, int row )
+{
+    uint low = 0;
+    uint high = rows.count();
+
+// the lists are sorted, find the first entry not below row
+    while ( low < high )
+    {
+        const uint mid = ( low + high ) / 2;
+
+        if ( rows[mid] < row )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if ( low < rows.count() && rows[low] == row )
+        return;
+
+    rows.insert( rows.begin() + low, row );
+}
+
+
+
+void PlaylistIndex::removeRow( QValueVector<int> &rows, int row )
+{
+    uint low = 0;
+    uint high = rows.count();
+
+    while ( low < high )
+    {
+        const uint mid = ( low + high ) / 2;
+
+        if ( rows[mid] < row )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if ( low < rows.count() && rows[low] == row )
+        rows.erase( rows.begin() + low );
+}
+
+
+
+QValueVector<int> PlaylistIndex::intersect( const QValueVector<int> &a, const QValueVector<int> &b )
+{
+    QValueVector<int> result;
+    result.reserve( QMIN( a.count(), b.count() ) );
+
+    uint i = 0, j = 0;
+
+    while ( i < a.count() && j < b.count() )
+    {
+        if ( a[i] < b[j] )
+            ++i;
+        else if ( a[i] > b[j] )
+            ++j;
+        else
+        {
+            result.push_back( a[i] );
+            ++i;
+            ++j;
+        }
+    }
+
+    return result;
+}
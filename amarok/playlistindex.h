@@ -0,0 +1,73 @@
+/***************************************************************************
+                          playlistindex.h  -  description
+                             -------------------
+    begin                : Mon Mai 5 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PLAYLISTINDEX_H
+#define PLAYLISTINDEX_H
+
+#include <qmap.h>
+#include <qstring.h>
+#include <qvaluelist.h>
+#include <qvaluevector.h>
+
+class PlaylistModel;
+
+/**
+ * Search index for the playlist filter. Holds the lowercased display text of
+ * every track and a trigram index over it. Results of the last queries are
+ * kept, so typing another character only re-checks the current matches and
+ * deleting one just returns the previous result.
+ *@author mark
+ */
+
+class PlaylistIndex
+{
+    public:
+        PlaylistIndex( const PlaylistModel *model );
+        ~PlaylistIndex();
+
+        void invalidate();
+        void updateRow( int row );
+        QValueVector<int> match( const QString &text );
+
+    private:
+        struct Result
+        {
+            QString query;
+            QValueVector<int> rows;
+        };
+
+        void buildTexts();
+        void buildGrams();
+        QValueVector<int> gramCandidates( const QString &query );
+
+        void addGrams( const QString &str, int row );
+        void removeGrams( const QString &str, int row );
+
+        static uint gramKey( const QChar *c );
+        static void insertRow( QValueVector<int> &rows, int row );
+        static void removeRow( QValueVector<int> &rows, int row );
+        static QValueVector<int> intersect( const QValueVector<int> &a, const QValueVector<int> &b );
+
+// ATTRIBUTES ------
+        const PlaylistModel *m_pModel;
+        QValueVector<QString> m_texts;
+        QMap<uint, QValueVector<int> > m_grams;
+        QValueList<Result> m_results;
+        bool m_textsValid;
+        bool m_gramsValid;
+};
+#endif
@@ -17,7 +17,6 @@
 
 #include "playerapp.h"
 #include "playlistitem.h"
-#include "playlistwidget.h"
 #include "browserwin.h"
 
 #include <qlistview.h>
@@ -29,7 +28,6 @@
 
 #include <kdebug.h>
 #include <kurl.h>
-#include <kfilemetainfo.h>
 
 PlaylistItem::PlaylistItem( QListView* parent, const KURL &url ) :
 QListViewItem( parent, nameForUrl( url ) )
@@ -54,29 +52,13 @@ QListViewItem( parent, after )
 
 PlaylistItem::~PlaylistItem()
 {
-    if ( listView() )
-    {
-        if ( QString( listView()->name() ) == "PlaylistWidget" )
-        {
-            PlaylistWidget *parentView = static_cast<PlaylistWidget*>( listView() );
-
-            if ( parentView->currentTrack() == this )
-            {
-                parentView->setCurrentTrack( NULL );
-            }
-        }
-    }
-
-    delete m_pMetaInfo;
 }
 
 
 
 void PlaylistItem::init()
 {
-    m_pMetaInfo = NULL;
     m_isDir = false;
-    m_bIsGlowing = false;
     setDragEnabled( true );
     setDropEnabled( true );
 }
@@ -95,45 +77,6 @@ QString PlaylistItem::nameForUrl( const KURL &url ) const
 
 // METHODS -------------------------------------------------------
 
-void PlaylistItem::readMetaInfo()
-{
-    if ( m_url.protocol() == "file" )
-    {
-        m_pMetaInfo = new KFileMetaInfo( m_url.path(), QString::null, KFileMetaInfo::Everything );
-    }
-}
-
-
-
-KFileMetaInfo* PlaylistItem::metaInfo()
-{
-    return m_pMetaInfo;
-}
-
-
-
-void PlaylistItem::setMetaTitle()
-{
-    if ( m_pMetaInfo)
-    {
-        if ( m_pMetaInfo->isValid() && !m_pMetaInfo->isEmpty() )
-        {
-            if ( m_pMetaInfo->item( "Title" ).string() != "---" )
-            {
-                QString str;
-
-                str += m_pMetaInfo->item( "Artist" ).string();
-                str += " - ";
-                str += m_pMetaInfo->item( "Title" ).string();
-
-                setText( 0, str );
-            }
-        }
-    }
-}
-
-
-
 bool PlaylistItem::isDir()
 {
     return m_isDir;
@@ -158,14 +101,7 @@ void PlaylistItem::paintCell( QPainter* p, const QColorGroup& /*cg*/, int /*colu
     QPainter pPainterBuf( pBufPixmap, true );
     pPainterBuf.setBackgroundColor( Qt::black );
 
-    if ( m_bIsGlowing )
-    {
-        pPainterBuf.setPen( m_glowCol );
-    }
-    else
-    {
-        pPainterBuf.setPen( col );
-    }
+    pPainterBuf.setPen( col );
 
     if ( isSelected() )
     {
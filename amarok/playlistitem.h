@@ -28,12 +28,11 @@ class QPainter;
 class QColorGroup;
 class QRect;
 
-class KFileMetaInfo;
-
 class PlayerApp;
 extern PlayerApp *pApp;
 
 /**
+ * Entry of the file browser. The playlist itself keeps its tracks in a PlaylistModel.
  *@author mark
  */
 
@@ -46,14 +45,8 @@ class PlaylistItem : public QListViewItem
         ~PlaylistItem();
 
         KURL url() const { return m_url; }
-        void readMetaInfo();
-        KFileMetaInfo *metaInfo();
-        void setMetaTitle();
         bool isDir();
         void setDir( bool on );
-        bool isGlowing() const  { return m_bIsGlowing; }
-        void setGlowing( bool b ) { m_bIsGlowing = b; }
-        void setGlowCol( QColor col ) { m_glowCol = col; }
 
     private:
         QString nameForUrl( const KURL &url ) const;
@@ -62,10 +55,6 @@ class PlaylistItem : public QListViewItem
         void paintFocus( QPainter* p, const QColorGroup& cg, const QRect& r );
 
         KURL m_url;
-        KFileMetaInfo *m_pMetaInfo;
-        bool m_bIsGlowing;
         bool m_isDir;
-        QString m_sPath;
-        QColor m_glowCol;
 };
 #endif
@@ -0,0 +1,197 @@
+/***************************************************************************
+                          playlistloader.cpp  -  description
+                             -------------------
+    begin                : Fre Mai 9 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "playlistloader.h"
+#include "playlistmodel.h"
+#include "playlistwidget.h"
+
+#include <qcstring.h>
+#include <qdatetime.h>
+#include <qfile.h>
+#include <qstring.h>
+#include <qtextcodec.h>
+#include <qvaluevector.h>
+
+#include <dcopclient.h>
+#include <kapplication.h>
+#include <kprogress.h>
+#include <kurl.h>
+
+#include <string.h>
+
+// tracks collected before they go into the playlist in one batch
+static const uint BATCH_SIZE = 10000;
+// lines parsed between two looks at the clock and the cancel button
+static const uint CHUNK_LINES = 2000;
+// files loading faster than this don't get a progress dialog
+static const int PROGRESS_DELAY = 500;
+
+
+PlaylistLoader::PlaylistLoader( PlaylistWidget *widget, const KURL &base ) :
+m_pWidget( widget ),
+m_base( base ),
+m_format( M3U ),
+m_after( -1 ),
+m_plsNumber( -1 ),
+m_pCodec( QTextCodec::codecForLocale() ),
+m_pProgress( 0 )
+{
+}
+
+
+
+PlaylistLoader::~PlaylistLoader()
+{
+    delete m_pProgress;
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+bool PlaylistLoader::load( const QString &fileName, Format format, int after )
+{
+    QFile file( fileName );
+
+    if ( !file.open( IO_ReadOnly ) )
+        return false;
+
+// even 100k entries are only a few MB, so we take the whole file at once
+    const QByteArray data = file.readAll();
+    file.close();
+
+    m_format = format;
+    m_after = after;
+    m_plsNumber = -1;
+    m_tracks.reserve( BATCH_SIZE );
+
+// processEvents() below must not let anything else change the rows we insert at: the widget
+// holds back scanned folders and tags, and DCOP calls like newInstance() wait until we're done
+    m_pWidget->setLoading( true );
+    kapp->dcopClient()->suspend();
+
+    QTime time;
+    time.start();
+
+    const char *d = data.data();
+    const uint size = data.size();
+    uint pos = 0;
+    uint lines = 0;
+
+    while ( pos < size )
+    {
+        const char *newline = static_cast<const char*>( memchr( d + pos, '\n', size - pos ) );
+        const uint end = newline ? newline - d : size;
+        uint length = end - pos;
+
+        if ( length && d[end - 1] == '\r' )
+            --length;
+        if ( length )
+            parseLine( d + pos, length );
+
+        pos = end + 1;
+
+        if ( ++lines % CHUNK_LINES )
+            continue;
+
+        if ( m_tracks.count() >= BATCH_SIZE )
+            flush();
+
+        if ( !m_pProgress && time.elapsed() < PROGRESS_DELAY )
+            continue;
+
+// cancelling keeps what has been loaded so far
+        if ( !updateProgress( pos, size ) )
+            break;
+    }
+
+    flush();
+
+    kapp->dcopClient()->resume();
+    m_pWidget->setLoading( false );
+
+    return true;
+}
+
+
+
+void PlaylistLoader::parseLine( const char *data, uint length )
+{
+    if ( m_format == M3U )
+    {
+        if ( data[0] != '#' )
+            m_tracks.push_back( PlaylistTrack( locationFor( m_pCodec->toUnicode( data, length ) ) ) );
+
+        return;
+    }
+
+    const QString line = m_pCodec->toUnicode( data, length );
+    const int equals = line.find( '=' );
+
+    if ( equals < 0 )
+        return;
+
+    if ( line.startsWith( "File" ) )
+    {
+        m_plsNumber = line.mid( 4, equals - 4 ).toInt();
+        m_tracks.push_back( PlaylistTrack( locationFor( line.mid( equals + 1 ) ) ) );
+    }
+    else if ( line.startsWith( "Title" ) && !m_tracks.isEmpty() && line.mid( 5, equals - 5 ).toInt() == m_plsNumber )
+        m_tracks.back().m_title = line.mid( equals + 1 );
+}
+
+
+
+QString PlaylistLoader::locationFor( const QString &entry ) const
+{
+// the model stores local files as plain path anyway, no need to parse them as URL
+    if ( entry.startsWith( "/" ) )
+        return entry;
+
+    return PlaylistModel::locationForUrl( KURL( m_base, entry ) );
+}
+
+
+
+void PlaylistLoader::flush()
+{
+    m_after = m_pWidget->insertTracks( m_after, m_tracks );
+    m_tracks.clear();
+    m_tracks.reserve( BATCH_SIZE );
+}
+
+
+
+bool PlaylistLoader::updateProgress( uint done, uint total )
+{
+    if ( !m_pProgress )
+    {
+        m_pProgress = new KProgressDialog( m_pWidget->topLevelWidget(), "PlaylistLoader",
+                                           "Loading Playlist", "Loading " + m_base.fileName() + "..", true );
+        m_pProgress->setAllowCancel( true );
+        m_pProgress->setAutoClose( false );
+        m_pProgress->progressBar()->setTotalSteps( 100 );
+        m_pProgress->show();
+    }
+
+    m_pProgress->progressBar()->setProgress( static_cast<int>( 100.0 * done / total ) );
+
+// the dialog is modal, so the user can't touch the playlist, and load() holds back everything else
+    kapp->processEvents();
+
+    return !m_pProgress->wasCancelled();
+}
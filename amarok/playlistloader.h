@@ -0,0 +1,70 @@
+/***************************************************************************
+                          playlistloader.h  -  description
+                             -------------------
+    begin                : Fre Mai 9 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PLAYLISTLOADER_H
+#define PLAYLISTLOADER_H
+
+#include "playlistmodel.h"
+
+#include <qstring.h>
+#include <qvaluevector.h>
+
+#include <kurl.h>
+
+class QTextCodec;
+
+class KProgressDialog;
+
+class PlaylistWidget;
+
+/**
+ * Reads M3U and PLS files into the playlist. The file is parsed in chunks,
+ * the tracks are collected off-screen and inserted in big batches, so the
+ * view is rebuilt a few times instead of once per line. Plain absolute
+ * paths, by far the most common entries, are taken as they are, without
+ * going through KURL. Big files get a progress dialog with a cancel button.
+ *@author mark
+ */
+
+class PlaylistLoader
+{
+    public:
+        enum Format { M3U, PLS };
+
+        PlaylistLoader( PlaylistWidget *widget, const KURL &base );
+        ~PlaylistLoader();
+
+        bool load( const QString &fileName, Format format, int after );
+
+    private:
+        void parseLine( const char *data, uint length );
+        QString locationFor( const QString &entry ) const;
+        void flush();
+        bool updateProgress( uint done, uint total );
+
+// ATTRIBUTES ------
+        PlaylistWidget *m_pWidget;
+        KURL m_base;                    // the playlist itself, relative entries are resolved against it
+        Format m_format;
+        int m_after;
+        int m_plsNumber;                // number of the last FileN= entry, TitleN= belongs to it
+        QValueVector<PlaylistTrack> m_tracks;
+
+        QTextCodec *m_pCodec;
+        KProgressDialog *m_pProgress;
+};
+#endif
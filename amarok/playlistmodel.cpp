@@ -0,0 +1,377 @@
+/***************************************************************************
+                          playlistmodel.cpp  -  description
+                             -------------------
+    begin                : Sam Mai 3 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "playlistmodel.h"
+#include "metabundle.h"
+
+#include <qstring.h>
+#include <qtl.h>
+#include <qvaluevector.h>
+
+#include <kapplication.h>
+#include <kurl.h>
+
+
+// sort helper, compares the display texts like QListView did
+struct PlaylistSortKey
+{
+    QString key;
+    int row;
+
+    bool operator<( const PlaylistSortKey &other ) const
+    {
+        return key.localeAwareCompare( other.key ) < 0;
+    }
+};
+
+
+
+PlaylistModel::PlaylistModel() :
+m_currentTrack( -1 ),
+m_currentRow( -1 )
+{
+}
+
+
+
+PlaylistModel::~PlaylistModel()
+{
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+QString PlaylistModel::locationForUrl( const KURL &url )
+{
+// local files are stored as plain path, that's shorter and saves us the URL parsing later
+    if ( url.isLocalFile() )
+        return url.path();
+    else
+        return url.url();
+}
+
+
+
+int PlaylistModel::insert( int after, const KURL &url )
+{
+    int row = after + 1;
+
+    if ( row < 0 || row > count() )
+        row = count();
+
+    m_tracks.insert( m_tracks.begin() + row, PlaylistTrack( locationForUrl( url ) ) );
+
+    if ( m_currentTrack >= row )
+        ++m_currentTrack;
+    if ( m_currentRow >= row )
+        ++m_currentRow;
+
+    return row;
+}
+
+
+
+int PlaylistModel::insert( int after, const QValueVector<PlaylistTrack> &tracks )
+{
+    int row = after + 1;
+
+    if ( row < 0 || row > count() )
+        row = count();
+
+    const int n = tracks.count();
+
+    if ( row == count() )
+    {
+        m_tracks.reserve( count() + n );
+
+        for ( int i = 0; i < n; ++i )
+            m_tracks.push_back( tracks[i] );
+    }
+    else
+    {
+// QValueVector can't insert a range, so build the result in one pass instead of moving the tail n times
+        QValueVector<PlaylistTrack> result;
+        result.reserve( count() + n );
+
+        for ( int i = 0; i < row; ++i )
+            result.push_back( m_tracks[i] );
+        for ( int i = 0; i < n; ++i )
+            result.push_back( tracks[i] );
+        for ( int i = row; i < count(); ++i )
+            result.push_back( m_tracks[i] );
+
+        m_tracks = result;
+    }
+
+    if ( m_currentTrack >= row )
+        m_currentTrack += n;
+    if ( m_currentRow >= row )
+        m_currentRow += n;
+
+    return row + n - 1;
+}
+
+
+
+void PlaylistModel::clear()
+{
+    m_tracks.clear();
+    m_strings.clear();
+    m_currentTrack = -1;
+    m_currentRow = -1;
+}
+
+
+
+void PlaylistModel::removeSelected()
+{
+    QValueVector<PlaylistTrack> tracks;
+    tracks.reserve( m_tracks.count() );
+
+    int currentTrack = -1;
+    int currentRow = -1;
+
+    for ( int i = 0; i < count(); ++i )
+    {
+        if ( m_tracks[i].m_flags & PlaylistTrack::Selected )
+            continue;
+
+        if ( i == m_currentTrack )
+            currentTrack = tracks.count();
+        if ( i == m_currentRow )
+            currentRow = tracks.count();
+
+        tracks.push_back( m_tracks[i] );
+    }
+
+    m_tracks = tracks;
+    m_currentTrack = currentTrack;
+    m_currentRow = currentRow;
+}
+
+
+
+int PlaylistModel::moveSelected( int after )
+{
+    QValueVector<int> order;
+    order.reserve( m_tracks.count() );
+
+    for ( int i = 0; i <= after && i < count(); ++i )
+        if ( !isSelected( i ) )
+            order.push_back( i );
+
+    int first = order.count();
+
+    for ( int i = 0; i < count(); ++i )
+        if ( isSelected( i ) )
+            order.push_back( i );
+
+    for ( int i = after + 1; i < count(); ++i )
+        if ( !isSelected( i ) )
+            order.push_back( i );
+
+    permute( order );
+    return first;
+}
+
+
+
+void PlaylistModel::sort( bool ascending )
+{
+    QValueVector<PlaylistSortKey> keys( m_tracks.count() );
+
+    for ( int i = 0; i < count(); ++i )
+    {
+        keys[i].key = text( i );
+        keys[i].row = i;
+    }
+
+    qHeapSort( keys );
+
+    QValueVector<int> order( m_tracks.count() );
+
+    for ( int i = 0; i < count(); ++i )
+        order[i] = keys[ ascending ? i : count() - 1 - i ].row;
+
+    permute( order );
+}
+
+
+
+void PlaylistModel::shuffle()
+{
+    QValueVector<int> order( m_tracks.count() );
+
+    for ( int i = 0; i < count(); ++i )
+        order[i] = i;
+
+    for ( int i = count() - 1; i > 0; --i )
+        qSwap( order[i], order[ KApplication::random() % ( i + 1 ) ] );
+
+    permute( order );
+}
+
+
+
+void PlaylistModel::permute( const QValueVector<int> &order )
+{
+    QValueVector<PlaylistTrack> tracks( order.count() );
+
+    int currentTrack = -1;
+    int currentRow = -1;
+
+    for ( uint i = 0; i < order.count(); ++i )
+    {
+        tracks[i] = m_tracks[ order[i] ];
+
+        if ( order[i] == m_currentTrack )
+            currentTrack = i;
+        if ( order[i] == m_currentRow )
+            currentRow = i;
+    }
+
+    m_tracks = tracks;
+    m_currentTrack = currentTrack;
+    m_currentRow = currentRow;
+}
+
+
+
+KURL PlaylistModel::url( int row ) const
+{
+    const QString &location = m_tracks[row].m_location;
+
+    if ( location.startsWith( "/" ) )
+    {
+        KURL url;
+        url.setPath( location );
+        return url;
+    }
+
+    return KURL( location );
+}
+
+
+
+QString PlaylistModel::text( int row ) const
+{
+    const PlaylistTrack &track = m_tracks[row];
+
+    if ( !track.m_title.isNull() )
+    {
+        if ( track.m_artist )
+            return m_strings.string( track.m_artist ) + " - " + track.m_title;
+
+        return track.m_title;
+    }
+
+// only files have a filename.. for all other protocols the url itself is used as the name
+    if ( track.m_location.startsWith( "/" ) )
+        return track.m_location.mid( track.m_location.findRev( '/' ) + 1 );
+    else
+        return track.m_location;
+}
+
+
+
+void PlaylistModel::setTitle( int row, const QString &title )
+{
+// titles from playlist files are complete, there's no separate artist
+    m_tracks[row].m_title = title;
+    m_tracks[row].m_artist = 0;
+}
+
+
+
+void PlaylistModel::setMetaInfo( int row, const MetaBundle &bundle )
+{
+    PlaylistTrack &track = m_tracks[row];
+    track.m_flags |= PlaylistTrack::MetaRead;
+
+    if ( !bundle.m_title.isEmpty() )
+    {
+        track.m_title = bundle.m_title;
+        track.m_artist = m_strings.intern( bundle.m_artist );
+    }
+
+    track.m_album = m_strings.intern( bundle.m_album );
+    track.m_genre = m_strings.intern( bundle.m_genre );
+    track.m_length = bundle.m_length;
+    track.m_sampleRate = bundle.m_sampleRate;
+    track.m_bitrate = QMIN( bundle.m_bitrate, 32767 );
+}
+
+
+
+MetaBundle PlaylistModel::metaInfo( int row ) const
+{
+    const PlaylistTrack &track = m_tracks[row];
+    MetaBundle bundle;
+
+    bundle.m_title = track.m_title;
+    bundle.m_artist = m_strings.string( track.m_artist );
+    bundle.m_album = m_strings.string( track.m_album );
+    bundle.m_genre = m_strings.string( track.m_genre );
+    bundle.m_length = track.m_length;
+    bundle.m_sampleRate = track.m_sampleRate;
+    bundle.m_bitrate = track.m_bitrate;
+
+    return bundle;
+}
+
+
+
+void PlaylistModel::clearSelection()
+{
+    for ( int i = 0; i < count(); ++i )
+        m_tracks[i].m_flags &= ~PlaylistTrack::Selected;
+}
+
+
+
+int PlaylistModel::firstSelected() const
+{
+    for ( int i = 0; i < count(); ++i )
+        if ( isSelected( i ) )
+            return i;
+
+    return -1;
+}
+
+
+
+KURL::List PlaylistModel::selectedURLs() const
+{
+    KURL::List list;
+
+    for ( int i = 0; i < count(); ++i )
+        if ( isSelected( i ) )
+            list.append( url( i ) );
+
+    return list;
+}
+
+
+
+void PlaylistModel::setFlag( int row, uint flag, bool on )
+{
+    if ( on )
+        m_tracks[row].m_flags |= flag;
+    else
+        m_tracks[row].m_flags &= ~flag;
+}
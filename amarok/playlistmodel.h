@@ -0,0 +1,118 @@
+/***************************************************************************
+                          playlistmodel.h  -  description
+                             -------------------
+    begin                : Sam Mai 3 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PLAYLISTMODEL_H
+#define PLAYLISTMODEL_H
+
+#include "stringpool.h"
+
+#include <qstring.h>
+#include <qvaluevector.h>
+
+#include <kurl.h>
+
+class MetaBundle;
+
+/**
+ * One entry of the playlist. This is kept as small as possible, since big
+ * playlists hold 100k+ of these in one contiguous vector. Only the title is
+ * a string of its own, artist, album and genre are ids into the model's
+ * StringPool.
+ */
+
+class PlaylistTrack
+{
+    public:
+        enum Flags { Selected = 1, MetaRead = 2 };
+
+        PlaylistTrack() :
+            m_artist( 0 ), m_album( 0 ), m_genre( 0 ), m_length( -1 ), m_sampleRate( -1 ), m_bitrate( -1 ), m_flags( 0 ) {}
+        PlaylistTrack( const QString &location ) : m_location( location ),
+            m_artist( 0 ), m_album( 0 ), m_genre( 0 ), m_length( -1 ), m_sampleRate( -1 ), m_bitrate( -1 ), m_flags( 0 ) {}
+
+// ATTRIBUTES ------
+        QString m_location;       // path for local files, complete URL for everything else
+        QString m_title;          // QString::null until set, the filename is shown instead
+        uint m_artist;
+        uint m_album;
+        uint m_genre;
+        int m_length;             // seconds, -1 if unknown
+        int m_sampleRate;         // Hz, -1 if unknown
+        short m_bitrate;          // kbit/s, -1 if unknown
+        ushort m_flags;
+};
+
+
+
+/**
+ * The data behind PlaylistWidget. Tracks are addressed by row; the model keeps
+ * the current track and the cursor row valid while rows are inserted,
+ * removed or reordered.
+ *@author mark
+ */
+
+class PlaylistModel
+{
+    public:
+        PlaylistModel();
+        ~PlaylistModel();
+
+        int count() const { return m_tracks.count(); }
+        const PlaylistTrack &track( int row ) const { return m_tracks[row]; }
+
+        int insert( int after, const KURL &url );
+        int insert( int after, const QValueVector<PlaylistTrack> &tracks );
+        void clear();
+        void removeSelected();
+        int moveSelected( int after );
+        void sort( bool ascending );
+        void shuffle();
+
+        KURL url( int row ) const;
+        QString text( int row ) const;
+        void setTitle( int row, const QString &title );
+        void setMetaInfo( int row, const MetaBundle &bundle );
+        MetaBundle metaInfo( int row ) const;
+        bool hasMetaInfo( int row ) const { return m_tracks[row].m_flags & PlaylistTrack::MetaRead; }
+
+        bool isSelected( int row ) const { return m_tracks[row].m_flags & PlaylistTrack::Selected; }
+        void setSelected( int row, bool on ) { setFlag( row, PlaylistTrack::Selected, on ); }
+        void clearSelection();
+        int firstSelected() const;
+        KURL::List selectedURLs() const;
+
+        int currentTrack() const { return m_currentTrack; }
+        void setCurrentTrack( int row ) { m_currentTrack = row; }
+        int currentRow() const { return m_currentRow; }
+        void setCurrentRow( int row ) { m_currentRow = row; }
+
+        const StringPool &strings() const { return m_strings; }
+        uint intern( const QString &str ) { return m_strings.intern( str ); }
+
+        static QString locationForUrl( const KURL &url );
+
+    private:
+        void setFlag( int row, uint flag, bool on );
+        void permute( const QValueVector<int> &order );
+
+// ATTRIBUTES ------
+        QValueVector<PlaylistTrack> m_tracks;
+        StringPool m_strings;
+        int m_currentTrack;
+        int m_currentRow;
+};
+#endif
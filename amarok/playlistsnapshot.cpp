@@ -0,0 +1,282 @@
+/***************************************************************************
+                          playlistsnapshot.cpp  -  description
+                             -------------------
+    begin                : Sam Mai 10 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "playlistsnapshot.h"
+#include "playlistmodel.h"
+#include "stringpool.h"
+
+#include <qfile.h>
+#include <qmemarray.h>
+#include <qstring.h>
+#include <qvaluevector.h>
+
+#include <kdebug.h>
+#include <ksavefile.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static const Q_UINT32 SNAPSHOT_MAGIC = 0x616d6b70;      // "amkp"
+static const Q_UINT32 SNAPSHOT_VERSION = 1;
+static const Q_UINT32 BYTE_ORDER_MARK = 0x01020304;
+// offset of a null string, the title of tracks that have none
+static const Q_UINT32 NULL_STRING = 0xffffffff;
+
+
+struct SnapshotHeader
+{
+    Q_UINT32 magic;
+    Q_UINT32 version;
+    Q_UINT32 byteOrder;
+    Q_UINT32 count;
+    Q_INT32 currentTrack;
+    Q_UINT32 poolCount;
+    Q_UINT32 stringsSize;           // in QChars
+    Q_UINT32 reserved;
+};
+
+
+struct SnapshotString
+{
+    Q_UINT32 offset;                // in QChars
+    Q_UINT32 length;
+};
+
+
+struct SnapshotRecord
+{
+    SnapshotString location;
+    SnapshotString title;
+    Q_UINT32 artist;                // pool entries
+    Q_UINT32 album;
+    Q_UINT32 genre;
+    Q_INT32 length;
+    Q_INT32 sampleRate;
+    Q_INT16 bitrate;
+    Q_UINT16 flags;
+};
+
+
+static void putString( const QString &str, SnapshotString &ref, QChar *strings, uint &pos )
+{
+    if ( str.isNull() )
+    {
+        ref.offset = NULL_STRING;
+        ref.length = 0;
+        return;
+    }
+
+    ref.offset = pos;
+    ref.length = str.length();
+    memcpy( strings + pos, str.unicode(), str.length() * sizeof( QChar ) );
+    pos += str.length();
+}
+
+
+static bool getString( const SnapshotString &ref, const QChar *strings, uint stringsSize, QString &str )
+{
+    if ( ref.offset == NULL_STRING )
+    {
+        str = QString::null;
+        return true;
+    }
+
+    if ( ref.offset > stringsSize || ref.length > stringsSize - ref.offset )
+        return false;
+
+    str = QString( strings + ref.offset, ref.length );
+    return true;
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+bool PlaylistSnapshot::save( const QString &fileName, const PlaylistModel &model )
+{
+    const StringPool &pool = model.strings();
+    const uint count = model.count();
+
+    uint stringsSize = 0;
+
+    for ( uint i = 0; i < pool.count(); ++i )
+        stringsSize += pool.string( i ).length();
+
+    for ( uint i = 0; i < count; ++i )
+        stringsSize += model.track( i ).m_location.length() + model.track( i ).m_title.length();
+
+    SnapshotHeader header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.count = count;
+    header.currentTrack = model.currentTrack();
+    header.poolCount = pool.count();
+    header.stringsSize = stringsSize;
+    header.reserved = 0;
+
+    QMemArray<SnapshotString> entries( pool.count() );
+    QMemArray<SnapshotRecord> records( count );
+    QMemArray<QChar> strings( stringsSize );
+    uint pos = 0;
+
+    for ( uint i = 0; i < pool.count(); ++i )
+        putString( pool.string( i ), entries[i], strings.data(), pos );
+
+    for ( uint i = 0; i < count; ++i )
+    {
+        const PlaylistTrack &track = model.track( i );
+        SnapshotRecord &record = records[i];
+
+        putString( track.m_location, record.location, strings.data(), pos );
+        putString( track.m_title, record.title, strings.data(), pos );
+        record.artist = track.m_artist;
+        record.album = track.m_album;
+        record.genre = track.m_genre;
+        record.length = track.m_length;
+        record.sampleRate = track.m_sampleRate;
+        record.bitrate = track.m_bitrate;
+// the selection is not part of the session
+        record.flags = track.m_flags & PlaylistTrack::MetaRead;
+    }
+
+    KSaveFile file( fileName );
+
+    if ( file.status() != 0 )
+        return false;
+
+    QFile *f = file.file();
+
+    f->writeBlock( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    f->writeBlock( reinterpret_cast<const char*>( entries.data() ), entries.size() * sizeof( SnapshotString ) );
+    f->writeBlock( reinterpret_cast<const char*>( records.data() ), records.size() * sizeof( SnapshotRecord ) );
+    f->writeBlock( reinterpret_cast<const char*>( strings.data() ), strings.size() * sizeof( QChar ) );
+
+    return file.close();
+}
+
+
+
+bool PlaylistSnapshot::load( const QString &fileName, PlaylistModel &model, int &currentTrack )
+{
+    const int fd = ::open( QFile::encodeName( fileName ), O_RDONLY );
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat st;
+
+    if ( ::fstat( fd, &st ) != 0 || st.st_size < static_cast<off_t>( sizeof( SnapshotHeader ) ) )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    void *map = ::mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+
+    if ( map == MAP_FAILED )
+        return false;
+
+    const bool ok = restore( static_cast<const char*>( map ), st.st_size, model, currentTrack );
+    ::munmap( map, st.st_size );
+
+    if ( !ok )
+        kdDebug() << "PlaylistSnapshot: " << fileName << " is damaged or from another version" << endl;
+
+    return ok;
+}
+
+
+
+bool PlaylistSnapshot::restore( const char *data, uint size, PlaylistModel &model, int &currentTrack )
+{
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader*>( data );
+
+    if ( header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION || header->byteOrder != BYTE_ORDER_MARK )
+        return false;
+
+// check the sizes in a way that can't overflow, before touching anything behind the header
+    uint left = size - sizeof( SnapshotHeader );
+
+    if ( header->poolCount > left / sizeof( SnapshotString ) )
+        return false;
+    left -= header->poolCount * sizeof( SnapshotString );
+
+    if ( header->count > left / sizeof( SnapshotRecord ) )
+        return false;
+    left -= header->count * sizeof( SnapshotRecord );
+
+    if ( left != header->stringsSize * sizeof( QChar ) )
+        return false;
+
+    const SnapshotString *entries = reinterpret_cast<const SnapshotString*>( header + 1 );
+    const SnapshotRecord *records = reinterpret_cast<const SnapshotRecord*>( entries + header->poolCount );
+    const QChar *strings = reinterpret_cast<const QChar*>( records + header->count );
+
+// the snapshot's pool ids are translated to the ids of the model's pool
+    QValueVector<uint> ids( header->poolCount );
+    QString str;
+
+    for ( uint i = 0; i < header->poolCount; ++i )
+    {
+        if ( !getString( entries[i], strings, header->stringsSize, str ) )
+            return false;
+
+        ids[i] = model.intern( str );
+    }
+
+    QValueVector<PlaylistTrack> tracks;
+    tracks.reserve( header->count );
+
+    for ( uint i = 0; i < header->count; ++i )
+    {
+        const SnapshotRecord &record = records[i];
+        PlaylistTrack track;
+
+        if ( !getString( record.location, strings, header->stringsSize, track.m_location ) ||
+             !getString( record.title, strings, header->stringsSize, track.m_title ) )
+            return false;
+
+        if ( record.artist >= header->poolCount || record.album >= header->poolCount || record.genre >= header->poolCount )
+            return false;
+
+        track.m_artist = ids[ record.artist ];
+        track.m_album = ids[ record.album ];
+        track.m_genre = ids[ record.genre ];
+        track.m_length = record.length;
+        track.m_sampleRate = record.sampleRate;
+        track.m_bitrate = record.bitrate;
+        track.m_flags = record.flags & PlaylistTrack::MetaRead;
+
+        tracks.push_back( track );
+    }
+
+    const int first = model.count();
+    model.insert( first - 1, tracks );
+
+    if ( header->currentTrack >= 0 && header->currentTrack < static_cast<int>( header->count ) )
+        currentTrack = first + header->currentTrack;
+    else
+        currentTrack = -1;
+
+    return true;
+}
@@ -0,0 +1,47 @@
+/***************************************************************************
+                          playlistsnapshot.h  -  description
+                             -------------------
+    begin                : Sam Mai 10 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PLAYLISTSNAPSHOT_H
+#define PLAYLISTSNAPSHOT_H
+
+#include <qstring.h>
+
+class PlaylistModel;
+
+/**
+ * Binary image of the playlist, written at exit and mapped back in at
+ * startup. It holds the complete track records including metadata, so the
+ * restore is one mmap plus building the model, without parsing text or
+ * reading tags again. The file is only meant for this machine: it is
+ * written in host byte order and ignored if that doesn't match.
+ *
+ * Layout, all in host byte order and 4 byte aligned:
+ *   header | pool entries | track records | UTF-16 string data
+ * Strings are referenced by offset and length in QChars.
+ *@author mark
+ */
+
+class PlaylistSnapshot
+{
+    public:
+        static bool save( const QString &fileName, const PlaylistModel &model );
+        static bool load( const QString &fileName, PlaylistModel &model, int &currentTrack );
+
+    private:
+        static bool restore( const char *data, uint size, PlaylistModel &model, int &currentTrack );
+};
+#endif
@@ -20,60 +20,421 @@
 #include "playerapp.h"
 #include "browserwin.h"
 #include "browserwidget.h"
+#include "dirscanner.h"
+#include "metabundle.h"
+#include "metacache.h"
+#include "metafetcher.h"
 #include "playlistitem.h"
+#include "playlistindex.h"
+#include "playlistmodel.h"
+#include "playlistsnapshot.h"
 
 #include <qcolor.h>
 #include <qevent.h>
+#include <qfileinfo.h>
+#include <qfont.h>
 #include <qmessagebox.h>
+#include <qpainter.h>
+#include <qpixmap.h>
 #include <qpoint.h>
 #include <qpopupmenu.h>
+#include <qscrollview.h>
 #include <qstringlist.h>
+#include <qtime.h>
 #include <qtimer.h>
 #include <qvaluelist.h>
 #include <qwidget.h>
 
 #include <kapplication.h>
 #include <kdebug.h>
-#include <kdirlister.h>
-#include <kfileitem.h>
-#include <klistview.h>
+#include <kglobalsettings.h>
+#include <kprogress.h>
 #include <kurl.h>
 #include <kurldrag.h>
 #include <klineedit.h>
 #include <kaccel.h>
+#include <kio/job.h>
 
+#include <sys/stat.h>
 
-PlaylistWidget::PlaylistWidget(QWidget *parent, const char *name ) : KListView(parent,name)
+// jobs handed to the MetaFetcher ahead of time
+static const uint MAX_META_JOBS = 64;
+// folder scans taking longer than this get a progress dialog
+static const int SCAN_PROGRESS_DELAY = 500;
+// KFileMetaInfo reads done per tick of the fallback timer, and the tick in ms
+static const int FALLBACK_READS = 2;
+static const int FALLBACK_INTERVAL = 20;
+
+
+PlaylistWidget::PlaylistWidget(QWidget *parent, const char *name ) : QScrollView(parent,name),
+m_index( &m_model )
 {
     setName( "PlaylistWidget" );
     setFocusPolicy( QWidget::ClickFocus );
     setPaletteBackgroundColor( pApp->m_bgColor );
-    setFullWidth( true );
-    setCurrentTrack( NULL );
+    setHScrollBarMode( QScrollView::AlwaysOff );
+
+// we paint every pixel of the viewport ourselves
+    viewport()->setBackgroundMode( Qt::NoBackground );
+    viewport()->setAcceptDrops( true );
+
+    m_rowHeight = fontMetrics().height() + 2;
+    m_filtered = false;
+    m_viewDirty = false;
+    m_updatePending = false;
+    m_anchorRow = -1;
+    m_pressRow = -1;
+    m_pendingSelect = false;
     m_playlistDirty = false;
+    m_loading = false;
+    m_scanFinishPending = false;
 
     mGlowCount = 100;
     mGlowAdd = 5;
     mGlowColor.setRgb( 0xff, 0x40, 0x40 );
+    m_glowCol = mGlowColor.light( mGlowCount );
 
     mGlowTimer = new QTimer( this );
     connect( mGlowTimer, SIGNAL( timeout() ), this, SLOT( slotGlowTimer() ) );
     mGlowTimer->start( 50 );
 
-    m_pDirLister = new KDirLister();
-    m_pDirLister->setAutoUpdate( false );
+    m_pScanner = 0;
+    m_scanRow = -1;
+    m_scanCount = 0;
+    m_pScanProgress = 0;
+
+    m_metaCursor = 0;
+    m_pMetaFetcher = new MetaFetcher( pApp->m_pMetaCache, this );
+    connect( m_pMetaFetcher, SIGNAL( resultsReady() ), this, SLOT( slotMetaInfoReady() ) );
+
+    m_pFallbackTimer = new QTimer( this );
+    connect( m_pFallbackTimer, SIGNAL( timeout() ), this, SLOT( slotReadFallback() ) );
 }
 
 
 
 PlaylistWidget::~PlaylistWidget()
 {
+    delete m_pScanProgress;
 }
 
 
 
 // METHODS -----------------------------------------------------------------
 
+void PlaylistWidget::drawContents( QPainter *p, int cx, int cy, int cw, int ch )
+{
+    const int rows = viewCount();
+    const int first = QMAX( cy / m_rowHeight, 0 );
+    const int last = QMIN( ( cy + ch ) / m_rowHeight, rows - 1 );
+
+    for ( int i = first; i <= last; ++i )
+        paintRow( p, viewToTrack( i ), i * m_rowHeight );
+
+    const int bottom = QMAX( ( last + 1 ) * m_rowHeight, cy );
+
+    if ( bottom < cy + ch )
+        p->fillRect( cx, bottom, cw, cy + ch - bottom, pApp->m_bgColor );
+}
+
+
+
+void PlaylistWidget::paintRow( QPainter *p, int row, int y )
+{
+    const int width = contentsWidth();
+    QColor col( pApp->m_fgColor );
+
+// one buffer for all rows, allocating a pixmap for every row painted is way too expensive
+    if ( m_rowBuffer.width() != width || m_rowBuffer.height() != m_rowHeight )
+        m_rowBuffer.resize( width, m_rowHeight );
+
+    QPainter pPainterBuf( &m_rowBuffer );
+    pPainterBuf.setFont( font() );
+
+    if ( m_model.isSelected( row ) )
+        pPainterBuf.fillRect( 0, 0, width, m_rowHeight, col.dark( 290 ) );
+    else
+        pPainterBuf.fillRect( 0, 0, width, m_rowHeight, pApp->m_bgColor );
+
+// only the current track glows, so there is no per-track state to clean up on track change
+    if ( row == m_model.currentTrack() )
+        pPainterBuf.setPen( m_glowCol );
+    else
+        pPainterBuf.setPen( col );
+
+    pPainterBuf.drawText( 1, 0, width - 1, m_rowHeight, Qt::AlignLeft | Qt::AlignVCenter | Qt::SingleLine, m_model.text( row ) );
+    pPainterBuf.end();
+
+    p->drawPixmap( 0, y, m_rowBuffer );
+}
+
+
+
+void PlaylistWidget::viewportResizeEvent( QResizeEvent *e )
+{
+    QScrollView::viewportResizeEvent( e );
+    slotUpdate();
+}
+
+
+
+void PlaylistWidget::fontChange( const QFont &oldFont )
+{
+    QScrollView::fontChange( oldFont );
+
+    m_rowHeight = fontMetrics().height() + 2;
+    triggerUpdate();
+}
+
+
+
+void PlaylistWidget::triggerUpdate()
+{
+// collects all changes done in one go into a single relayout
+    if ( !m_updatePending )
+    {
+        m_updatePending = true;
+        QTimer::singleShot( 0, this, SLOT( slotUpdate() ) );
+    }
+}
+
+
+
+void PlaylistWidget::invalidateView()
+{
+    m_viewDirty = true;
+    triggerUpdate();
+}
+
+
+
+void PlaylistWidget::updateView()
+{
+    if ( !m_viewDirty )
+        return;
+
+    m_viewDirty = false;
+    m_viewRows.clear();
+    m_filtered = !m_filter.isEmpty();
+
+    if ( m_filtered )
+        m_viewRows = m_index.match( m_filter );
+}
+
+
+
+void PlaylistWidget::modelChanged()
+{
+    m_index.invalidate();
+    m_anchorRow = -1;
+    m_metaCursor = 0;
+    invalidateView();
+}
+
+
+
+void PlaylistWidget::trackChanged( int row )
+{
+    m_index.updateRow( row );
+
+    if ( m_filtered )
+        invalidateView();
+    else
+        repaintTrack( row );
+}
+
+
+
+int PlaylistWidget::viewCount()
+{
+    updateView();
+
+    return m_filtered ? m_viewRows.count() : m_model.count();
+}
+
+
+
+int PlaylistWidget::viewToTrack( int viewRow )
+{
+    updateView();
+
+    return m_filtered ? m_viewRows[viewRow] : viewRow;
+}
+
+
+
+int PlaylistWidget::trackToView( int row )
+{
+    updateView();
+
+    if ( !m_filtered || row == -1 )
+        return row;
+
+// m_viewRows is sorted, since filtering keeps the order of the playlist
+    int low = 0;
+    int high = m_viewRows.count() - 1;
+
+    while ( low <= high )
+    {
+        int mid = ( low + high ) / 2;
+
+        if ( m_viewRows[mid] < row )
+            low = mid + 1;
+        else if ( m_viewRows[mid] > row )
+            high = mid - 1;
+        else
+            return mid;
+    }
+
+    return -1;
+}
+
+
+
+int PlaylistWidget::rowAt( int y )
+{
+    if ( y < 0 || y / m_rowHeight >= viewCount() )
+        return -1;
+
+    return viewToTrack( y / m_rowHeight );
+}
+
+
+
+void PlaylistWidget::repaintTrack( int row )
+{
+    int viewRow = trackToView( row );
+
+    if ( viewRow != -1 )
+        updateContents( 0, viewRow * m_rowHeight, contentsWidth(), m_rowHeight );
+}
+
+
+
+void PlaylistWidget::selectRange( int from, int to )
+{
+    int viewFrom = trackToView( from );
+    int viewTo = trackToView( to );
+
+    if ( viewFrom == -1 )
+        viewFrom = viewTo;
+    if ( viewFrom > viewTo )
+        qSwap( viewFrom, viewTo );
+
+    m_model.clearSelection();
+
+    for ( int i = viewFrom; i <= viewTo; ++i )
+        m_model.setSelected( viewToTrack( i ), true );
+}
+
+
+
+void PlaylistWidget::contentsMousePressEvent( QMouseEvent *e )
+{
+    const int row = rowAt( e->y() );
+
+    m_pressRow = row;
+    m_pressPos = e->pos();
+    m_pendingSelect = false;
+
+    if ( row == -1 )
+    {
+        if ( !( e->state() & ControlButton ) )
+            m_model.clearSelection();
+    }
+    else if ( e->button() == RightButton )
+    {
+        if ( !m_model.isSelected( row ) )
+        {
+            m_model.clearSelection();
+            m_model.setSelected( row, true );
+        }
+        m_model.setCurrentRow( row );
+        m_anchorRow = row;
+    }
+    else if ( e->state() & ShiftButton )
+    {
+        selectRange( m_anchorRow != -1 ? m_anchorRow : m_model.currentRow(), row );
+        m_model.setCurrentRow( row );
+    }
+    else if ( e->state() & ControlButton )
+    {
+        m_model.setSelected( row, !m_model.isSelected( row ) );
+        m_model.setCurrentRow( row );
+        m_anchorRow = row;
+    }
+    else if ( m_model.isSelected( row ) )
+    {
+// this might be the start of a drag, so we reduce the selection on release
+        m_pendingSelect = true;
+        m_model.setCurrentRow( row );
+        m_anchorRow = row;
+    }
+    else
+    {
+        m_model.clearSelection();
+        m_model.setSelected( row, true );
+        m_model.setCurrentRow( row );
+        m_anchorRow = row;
+    }
+
+    viewport()->update();
+
+    if ( e->button() == RightButton )
+        emit rightButtonPressed( row, e->globalPos() );
+}
+
+
+
+void PlaylistWidget::contentsMouseMoveEvent( QMouseEvent *e )
+{
+    if ( !( e->state() & LeftButton ) || m_pressRow == -1 || !m_model.isSelected( m_pressRow ) )
+        return;
+
+    if ( ( e->pos() - m_pressPos ).manhattanLength() < KGlobalSettings::dndEventDelay() )
+        return;
+
+    m_pendingSelect = false;
+    m_pressRow = -1;
+
+    KURLDrag *drag = KURLDrag::newDrag( m_model.selectedURLs(), viewport() );
+    drag->drag();
+}
+
+
+
+void PlaylistWidget::contentsMouseReleaseEvent( QMouseEvent *e )
+{
+    if ( m_pendingSelect && rowAt( e->y() ) == m_pressRow )
+    {
+        m_model.clearSelection();
+        m_model.setSelected( m_pressRow, true );
+        viewport()->update();
+    }
+
+    m_pendingSelect = false;
+    m_pressRow = -1;
+}
+
+
+
+void PlaylistWidget::contentsMouseDoubleClickEvent( QMouseEvent *e )
+{
+    const int row = rowAt( e->y() );
+
+    if ( row != -1 && e->button() == LeftButton )
+        emit doubleClicked( row );
+}
+
+
+
+void PlaylistWidget::contentsDragEnterEvent( QDragEnterEvent* e )
+{
+    e->accept();
+}
+
+
+
 void PlaylistWidget::contentsDragMoveEvent( QDragMoveEvent* e)
 {
     e->acceptAction();
@@ -83,13 +444,16 @@ void PlaylistWidget::contentsDragMoveEvent( QDragMoveEvent* e)
 
 void PlaylistWidget::contentsDropEvent( QDropEvent* e )
 {
-    m_dropRecursionCounter = 0;
-
     if ( pApp->m_optDropMode == "Recursively" )
         m_dropRecursively = true;
     else
         m_dropRecursively = false;
 
+    int row = rowAt( e->pos().y() );
+
+    if ( row == -1 )                              // dropped below the last track -> append
+        row = count() - 1;
+
     KURL::List urlList;
 
     if ( e->source() == NULL )                    // dragging from inside amarok or outside?
@@ -97,18 +461,17 @@ void PlaylistWidget::contentsDropEvent( QDropEvent* e )
         if( !KURLDrag::decode( e, urlList ) || urlList.isEmpty() )
             return;
 
-        setUpdatesEnabled( false );
-        m_pDropCurrentItem = static_cast<PlaylistItem*>( itemAt( e->pos() ) );
+        m_dropRow = row;
         playlistDrop( urlList );
     }
+    else if ( e->source() == viewport() )         // drag is inside this widget, do a move operation
+    {
+        m_model.moveSelected( row );
+    }
     else
     {
         PlaylistItem *srcItem, *newItem;
-
-        if ( e->source()->parent() == this )
-            srcItem = static_cast<PlaylistItem*>( firstChild() );
-        else
-            srcItem = static_cast<PlaylistItem*>( pApp->m_pBrowserWin->m_pBrowserWidget->firstChild() );
+        srcItem = static_cast<PlaylistItem*>( pApp->m_pBrowserWin->m_pBrowserWidget->firstChild() );
 
         bool containsDirs = false;
 
@@ -122,9 +485,6 @@ void PlaylistWidget::contentsDropEvent( QDropEvent* e )
 
                 if ( srcItem->isDir() )
                     containsDirs = true;
-// if drag is inside this widget, do a move operation
-                if ( e->source()->parent() == this )
-                    delete srcItem;
             }
             srcItem = newItem;
         }
@@ -132,21 +492,14 @@ void PlaylistWidget::contentsDropEvent( QDropEvent* e )
         {
             QPopupMenu popup( this );
             popup.insertItem( "Add Recursively", this, SLOT( slotSetRecursive() ) );
-            popup.exec( mapToGlobal( QPoint( e->pos().x() - 120, e->pos().y() - 20 ) ) );
+            popup.exec( viewport()->mapToGlobal( contentsToViewport( QPoint( e->pos().x() - 120, e->pos().y() - 20 ) ) ) );
         }
 
-        setUpdatesEnabled( false );
-
-        m_pDropCurrentItem = static_cast<PlaylistItem*>( itemAt( e->pos() ) );
-
-        if ( !m_pDropCurrentItem )
-            m_pDropCurrentItem = (PlaylistItem*) 1;
-
+        m_dropRow = row;
         playlistDrop( urlList );
     }
 
-    setUpdatesEnabled( true );
-    triggerUpdate();
+    modelChanged();
     e->acceptAction();
 }
 
@@ -154,93 +507,191 @@ void PlaylistWidget::contentsDropEvent( QDropEvent* e )
 
 void PlaylistWidget::playlistDrop( KURL::List urlList )
 {
-    ++m_dropRecursionCounter;
+    ScanRequest request;
 
     for( KURL::List::Iterator it = urlList.begin(); it != urlList.end(); it++ )
     {
-        m_pDirLister->openURL( ( *it ).upURL(), false, false );   // URL; keep = true, reload = true
-        while( !m_pDirLister->isFinished() )
-            kapp->processEvents( 300 );
+// folders are walked in the background, everything else is added right away
+        if ( ( *it ).isLocalFile() && QFileInfo( ( *it ).path() ).isDir() )
+            request.m_dirs.append( ( *it ).path() );
+        else if ( pApp->m_pBrowserWin->isFileValid( *it ) )
+            m_dropRow = addItem( m_dropRow, *it );
+// the scanner only walks local folders, remote ones are listed by KIO, which fails on anything else
+        else if ( !pApp->loadPlaylist( *it, m_dropRow ) && !( *it ).isLocalFile() )
+            listRemote( *it, m_dropRow, m_dropRecursively );
+    }
 
-        KFileItem *fileItem = m_pDirLister->findByURL( *it );
+    if ( request.m_dirs.isEmpty() )
+        return;
 
-        if ( !fileItem )
-            kdDebug() << "fileItem is 0!" << endl;
+    request.m_after = m_dropRow;
+    request.m_recursive = m_dropRecursively;
 
-        if ( fileItem && fileItem->isDir() )
-        {
-            if ( fileItem->isLink() && !pApp->m_optFollowSymlinks && m_dropRecursionCounter >= 2 )
-                continue;
+    if ( m_pScanner )
+        m_scanQueue.append( request );
+    else
+        startScan( request );
+}
 
-            if ( m_dropRecursionCounter >= 50 )     //no infinite loops, please
-                continue;
 
-            if ( !m_dropRecursively && m_dropRecursionCounter >= 2 )
-                continue;
 
-            m_pDirLister->openURL( *it, false, false );  // URL; keep = false, reload = true
-            while( !m_pDirLister->isFinished() )
-                kapp->processEvents( 300 );
+void PlaylistWidget::startScan( const ScanRequest &request )
+{
+    m_scanRow = request.m_after;
+    m_scanCount = 0;
+    m_scanTime.start();
 
-            KURL::List dirList;
-            KFileItemList myItems = m_pDirLister->items();
-            KFileItemListIterator it( myItems );
+    m_pScanner = new DirScanner( request.m_recursive, pApp->m_optFollowSymlinks, this );
+    connect( m_pScanner, SIGNAL( filesFound() ), this, SLOT( slotScanFiles() ) );
+    connect( m_pScanner, SIGNAL( finished() ), this, SLOT( slotScanFinished() ) );
+    m_pScanner->scan( request.m_dirs );
 
-            while ( *it )
-            {
-                if ( ( (*it)->url().path() != "." ) && ( (*it)->url().path() != ".." ) )
-                    dirList.append( (*it)->url() );
-                ++it;
-            }
+    QTimer::singleShot( SCAN_PROGRESS_DELAY, this, SLOT( slotScanProgress() ) );
+}
 
-            playlistDrop( dirList );
-        }
-        else
+
+
+void PlaylistWidget::listRemote( const KURL &url, int after, bool recursive )
+{
+    KIO::ListJob *job = recursive ? KIO::listRecursive( url, false, false ) : KIO::listDir( url, false, false );
+
+    connect( job, SIGNAL( entries( KIO::Job*, const KIO::UDSEntryList& ) ),
+             this, SLOT( slotRemoteEntries( KIO::Job*, const KIO::UDSEntryList& ) ) );
+    connect( job, SIGNAL( result( KIO::Job* ) ), this, SLOT( slotRemoteResult( KIO::Job* ) ) );
+
+    m_remoteListings[job].m_after = after;
+}
+
+
+
+void PlaylistWidget::flushRemote( bool all )
+{
+    QMap<KIO::Job*, RemoteListing>::Iterator it = m_remoteListings.begin();
+
+    while ( it != m_remoteListings.end() )
+    {
+        RemoteListing &listing = it.data();
+
+// rows may have been removed while listing
+        listing.m_after = insertTracks( QMIN( listing.m_after, count() - 1 ), listing.m_tracks );
+        listing.m_tracks.clear();
+
+        if ( all && listing.m_done )
         {
-            if ( pApp->m_pBrowserWin->isFileValid( *it ) )
-            {
-                m_pDropCurrentItem = addItem( m_pDropCurrentItem, *it );
-            }
-            else
-            {
-                if ( m_dropRecursionCounter <= 1 )
-                    pApp->loadPlaylist( *it, m_pDropCurrentItem );
-            }
+            QMap<KIO::Job*, RemoteListing>::Iterator done = it;
+            ++it;
+            m_remoteListings.remove( done );
         }
+        else
+            ++it;
     }
-    --m_dropRecursionCounter;
 }
 
 
 
-QListViewItem* PlaylistWidget::currentTrack()
+void PlaylistWidget::stopScan()
 {
-    return m_pCurrentTrack;
+    m_scanQueue.clear();
+
+    for ( QMap<KIO::Job*, RemoteListing>::Iterator it = m_remoteListings.begin(); it != m_remoteListings.end(); ++it )
+    {
+        if ( !it.data().m_done )
+            it.key()->kill();
+    }
+
+    m_remoteListings.clear();
+
+    if ( m_pScanner )
+        m_pScanner->cancel();
 }
 
 
 
-void PlaylistWidget::setCurrentTrack( QListViewItem *item )
+int PlaylistWidget::currentTrack() const
 {
-    m_pCurrentTrack = item;
+    return m_model.currentTrack();
 }
 
 
 
-void PlaylistWidget::unglowItems()
+void PlaylistWidget::setCurrentTrack( int row )
 {
-    PlaylistItem *item = static_cast<PlaylistItem*>( firstChild() );
+    int oldRow = m_model.currentTrack();
 
-    while ( item != NULL )
-    {
-        if ( item->isGlowing() )
-        {
-            item->setGlowing( false );
-            repaintItem( item );
-        }
+    if ( row == oldRow )
+        return;
 
-        item = static_cast<PlaylistItem*>( item->nextSibling() );
-    }
+    m_model.setCurrentTrack( row );
+
+    if ( oldRow != -1 )
+        repaintTrack( oldRow );
+    if ( row != -1 )
+        repaintTrack( row );
+}
+
+
+
+int PlaylistWidget::currentRow() const
+{
+    return m_model.currentRow();
+}
+
+
+
+void PlaylistWidget::setCurrentRow( int row )
+{
+    m_model.clearSelection();
+
+    if ( row != -1 )
+        m_model.setSelected( row, true );
+
+    m_model.setCurrentRow( row );
+    m_anchorRow = row;
+
+    ensureTrackVisible( row );
+    viewport()->update();
+}
+
+
+
+void PlaylistWidget::moveCursor( int rows )
+{
+    const int viewRows = viewCount();
+
+    if ( viewRows == 0 )
+        return;
+
+    int viewRow = trackToView( m_model.currentRow() );
+
+    if ( viewRow == -1 )
+        viewRow = 0;
+    else
+        viewRow = QMIN( QMAX( viewRow + rows, 0 ), viewRows - 1 );
+
+    setCurrentRow( viewToTrack( viewRow ) );
+}
+
+
+
+int PlaylistWidget::visibleRows() const
+{
+    return QMAX( visibleHeight() / m_rowHeight, 1 );
+}
+
+
+
+void PlaylistWidget::ensureTrackVisible( int row )
+{
+    int viewRow = trackToView( row );
+
+    if ( viewRow == -1 )
+        return;
+
+// contents size must be up to date, or QScrollView won't scroll far enough
+    if ( m_updatePending )
+        slotUpdate();
+
+    ensureVisible( 0, viewRow * m_rowHeight + m_rowHeight / 2, 0, m_rowHeight / 2 );
 }
 
 
@@ -256,65 +707,432 @@ void PlaylistWidget::focusInEvent( QFocusEvent *e )
 {
     pApp->m_pBrowserWin->m_pPlaylistLineEdit->setFocus();
 
-    KListView::focusInEvent( e );
+    QScrollView::focusInEvent( e );
 }
 
 
 
 void PlaylistWidget::fetchMetaInfo()
 {
-    if ( m_playlistDirty )
+    if ( !m_playlistDirty )
+        return;
+
+// rows on screen go first, they are what the user is waiting for
+    const int rows = viewCount();
+    const int first = QMAX( contentsY() / m_rowHeight, 0 );
+    const int last = QMIN( ( contentsY() + visibleHeight() ) / m_rowHeight, rows - 1 );
+
+    for ( int i = first; i <= last; ++i )
+        queueMetaInfo( viewToTrack( i ), true );
+
+// the rest is fed in small portions, so the queue stays short and urgent jobs don't wait long
+    while ( m_metaCursor < count() && m_pMetaFetcher->pending() < MAX_META_JOBS )
+        queueMetaInfo( m_metaCursor++, false );
+
+    if ( m_metaCursor >= count() && m_pMetaFetcher->isIdle() )
+        m_playlistDirty = false;
+}
+
+
+
+MetaBundle PlaylistWidget::metaInfo( int row )
+{
+// somebody needs it right now, so don't wait for the fetcher to get there
+    if ( !m_model.hasMetaInfo( row ) && m_model.track( row ).m_location.startsWith( "/" ) )
+    {
+        MetaBundle bundle;
+        pApp->m_pMetaCache->read( m_model.track( row ).m_location, bundle );
+        m_model.setMetaInfo( row, bundle );
+        trackChanged( row );
+    }
+
+    return m_model.metaInfo( row );
+}
+
+
+
+void PlaylistWidget::queueMetaInfo( int row, bool urgent )
+{
+    if ( m_model.hasMetaInfo( row ) )
+        return;
+
+    const QString &location = m_model.track( row ).m_location;
+
+// only local files have tags we can read
+    if ( !location.startsWith( "/" ) )
+        m_model.setMetaInfo( row, MetaBundle() );
+    else if ( !m_pMetaFetcher->isQueued( location ) && !m_fallbackBusy.contains( location ) )
+        m_pMetaFetcher->queue( row, location, urgent );
+}
+
+
+
+int PlaylistWidget::addItem( int after, const KURL &url )
+{
+    m_playlistDirty = true;
+    int row = m_model.insert( after, url );
+    modelChanged();
+
+    return row;
+}
+
+
+
+int PlaylistWidget::insertTracks( int after, const QValueVector<PlaylistTrack> &tracks )
+{
+    if ( tracks.isEmpty() )
+        return after;
+
+    m_playlistDirty = true;
+    int row = m_model.insert( after, tracks );
+    modelChanged();
+
+    return row;
+}
+
+
+
+void PlaylistWidget::setLoading( bool loading )
+{
+    m_loading = loading;
+
+    if ( loading )
+        return;
+
+// catch up on what came in while the loader had the playlist
+    flushRemote( true );
+
+    if ( m_scanFinishPending )
+        slotScanFinished();
+    else
+        slotScanFiles();
+
+    slotMetaInfoReady();
+}
+
+
+
+bool PlaylistWidget::saveSnapshot( const QString &fileName ) const
+{
+    return PlaylistSnapshot::save( fileName, m_model );
+}
+
+
+
+bool PlaylistWidget::restoreSnapshot( const QString &fileName )
+{
+    int current;
+
+    if ( !PlaylistSnapshot::load( fileName, m_model, current ) )
+        return false;
+
+// tracks that had no metadata yet when the snapshot was taken still need it
+    m_playlistDirty = true;
+    modelChanged();
+
+    if ( current != -1 )
+        setCurrentTrack( current );
+
+    return true;
+}
+
+
+
+void PlaylistWidget::setTitle( int row, const QString &title )
+{
+    m_model.setTitle( row, title );
+    trackChanged( row );
+}
+
+
+
+void PlaylistWidget::removeSelected()
+{
+    m_model.removeSelected();
+    modelChanged();
+}
+
+
+
+void PlaylistWidget::clear()
+{
+    stopScan();
+    m_model.clear();
+    m_pMetaFetcher->clear();
+    m_fallbackJobs.clear();
+    m_fallbackBusy.clear();
+    m_pFallbackTimer->stop();
+    m_playlistDirty = false;
+    modelChanged();
+}
+
+
+
+void PlaylistWidget::sort( bool ascending )
+{
+    m_model.sort( ascending );
+    modelChanged();
+}
+
+
+
+void PlaylistWidget::shuffle()
+{
+    m_model.shuffle();
+    modelChanged();
+}
+
+
+
+// SLOTS ----------------------------------------------
+
+void PlaylistWidget::slotUpdate()
+{
+    m_updatePending = false;
+
+    resizeContents( visibleWidth(), QMAX( viewCount() * m_rowHeight, visibleHeight() ) );
+    viewport()->update();
+}
+
+
+
+void PlaylistWidget::slotMetaInfoReady()
+{
+// the results wait in the fetcher, setLoading() picks them up
+    if ( m_loading )
+        return;
+
+    const QValueList<MetaFetcher::Job> results = m_pMetaFetcher->takeResults();
+
+    for ( QValueList<MetaFetcher::Job>::ConstIterator it = results.begin(); it != results.end(); ++it )
     {
-        PlaylistItem *item = static_cast<PlaylistItem*>( firstChild() );
+        const int row = ( *it ).m_row;
 
-        while( item )
+// the playlist changed while the job was running, the track gets queued again from its new row
+        if ( row >= count() || m_model.track( row ).m_location != ( *it ).m_location )
         {
-            if ( !item->metaInfo() )
-            {
-                item->readMetaInfo();
-                item->setMetaTitle();
-                break;
-            }
+            m_metaCursor = 0;
+            m_playlistDirty = true;
+            continue;
+        }
 
-            item = static_cast<PlaylistItem*>( item->nextSibling() );
+        if ( m_model.hasMetaInfo( row ) )
+            continue;
+
+// formats TagReader doesn't know go through KFileMetaInfo, which only works in this thread
+// and can take long, so those are read a few at a time from a timer
+        if ( !( *it ).m_ok )
+        {
+            m_fallbackJobs.append( *it );
+            m_fallbackBusy.insert( ( *it ).m_location, 0 );
+            continue;
         }
 
-        if ( !item )
-            m_playlistDirty = false;
+        m_model.setMetaInfo( row, ( *it ).m_bundle );
+        trackChanged( row );
     }
+
+    if ( !m_fallbackJobs.isEmpty() && !m_pFallbackTimer->isActive() )
+        m_pFallbackTimer->start( FALLBACK_INTERVAL );
+
+    if ( pApp->m_optReadMetaInfo )
+        fetchMetaInfo();
 }
 
 
 
-PlaylistItem* PlaylistWidget::addItem( PlaylistItem *after, KURL url )
+void PlaylistWidget::slotReadFallback()
 {
-    m_playlistDirty = true;
+    for ( int i = 0; i < FALLBACK_READS && !m_fallbackJobs.isEmpty(); ++i )
+    {
+        const MetaFetcher::Job job = m_fallbackJobs.first();
+        m_fallbackJobs.remove( m_fallbackJobs.begin() );
+        m_fallbackBusy.remove( job.m_location );
+
+        const int row = job.m_row;
 
-    if ( (unsigned long) after == 1 )
+        if ( row >= count() || m_model.track( row ).m_location != job.m_location )
+        {
+            m_metaCursor = 0;
+            m_playlistDirty = true;
+            continue;
+        }
+
+        if ( m_model.hasMetaInfo( row ) )
+            continue;
+
+        MetaBundle bundle;
+        pApp->m_pMetaCache->read( job.m_location, bundle );
+        m_model.setMetaInfo( row, bundle );
+        trackChanged( row );
+    }
+
+    if ( m_fallbackJobs.isEmpty() )
     {
-        return new PlaylistItem( this, lastItem(), url );
+        m_pFallbackTimer->stop();
+
+        if ( pApp->m_optReadMetaInfo )
+            fetchMetaInfo();
     }
-    else
+}
+
+
+
+void PlaylistWidget::slotScanFiles()
+{
+// the files wait in the scanner, setLoading() picks them up
+    if ( !m_pScanner || m_loading )
+        return;
+
+    const QStringList files = m_pScanner->takeFiles();
+    QValueVector<PlaylistTrack> tracks;
+    tracks.reserve( files.count() );
+
+    for ( QStringList::ConstIterator it = files.begin(); it != files.end(); ++it )
     {
-        return new PlaylistItem( this, after, url );
+        if ( pApp->m_pBrowserWin->isFileValid( *it ) )
+            tracks.push_back( PlaylistTrack( *it ) );
+    }
+
+// rows may have been removed while scanning
+    m_scanRow = insertTracks( QMIN( m_scanRow, count() - 1 ), tracks );
+    m_scanCount += tracks.count();
+
+    if ( m_pScanProgress )
+    {
+        m_pScanProgress->setLabel( QString( "%1 tracks added.." ).arg( m_scanCount ) );
+        m_pScanProgress->progressBar()->advance( 1 );
     }
 }
 
 
 
-// SLOTS ----------------------------------------------
+void PlaylistWidget::slotScanFinished()
+{
+    if ( m_loading )
+    {
+        m_scanFinishPending = true;
+        return;
+    }
+
+    m_scanFinishPending = false;
+
+// the last files may have come in together with the end of the scan
+    slotScanFiles();
+
+    delete m_pScanProgress;
+    m_pScanProgress = 0;
+
+// we're called from the scanner's own event handler, so it can't be deleted right here
+    m_pScanner->deleteLater();
+    m_pScanner = 0;
+
+    if ( !m_scanQueue.isEmpty() )
+    {
+        const ScanRequest request = m_scanQueue.first();
+        m_scanQueue.remove( m_scanQueue.begin() );
+        startScan( request );
+    }
+}
+
+
+
+void PlaylistWidget::slotScanProgress()
+{
+    if ( !m_pScanner || m_pScanProgress || m_scanTime.elapsed() < SCAN_PROGRESS_DELAY )
+        return;
+
+// not modal, the playlist can be used while the folders are added
+    m_pScanProgress = new KProgressDialog( topLevelWidget(), "DirScanner",
+                                           "Adding Folders", "Scanning folders..", false );
+    m_pScanProgress->setAllowCancel( true );
+    m_pScanProgress->setAutoClose( false );
+    m_pScanProgress->progressBar()->setTotalSteps( 0 );
+    connect( m_pScanProgress, SIGNAL( cancelClicked() ), this, SLOT( slotCancelScan() ) );
+    m_pScanProgress->show();
+}
+
+
+
+void PlaylistWidget::slotCancelScan()
+{
+    stopScan();
+}
+
+
+
+void PlaylistWidget::slotRemoteEntries( KIO::Job *job, const KIO::UDSEntryList &entries )
+{
+    if ( !m_remoteListings.contains( job ) )
+        return;
+
+    const KURL base = static_cast<KIO::ListJob*>( job )->url();
+    QStringList names;
+
+    for ( KIO::UDSEntryList::ConstIterator it = entries.begin(); it != entries.end(); ++it )
+    {
+        QString name;
+        bool dir = false;
+
+        for ( KIO::UDSEntry::ConstIterator atom = ( *it ).begin(); atom != ( *it ).end(); ++atom )
+        {
+            if ( ( *atom ).m_uds == KIO::UDS_NAME )
+                name = ( *atom ).m_str;
+            else if ( ( *atom ).m_uds == KIO::UDS_FILE_TYPE )
+                dir = S_ISDIR( ( *atom ).m_long );
+        }
+
+        if ( !dir && !name.isEmpty() )
+            names.append( name );
+    }
+
+// the server lists a folder in no particular order, a batch usually holds one folder
+    names.sort();
+
+    QValueVector<PlaylistTrack> &tracks = m_remoteListings[job].m_tracks;
+
+    for ( QStringList::ConstIterator it = names.begin(); it != names.end(); ++it )
+    {
+        KURL url( base );
+        url.addPath( *it );
+
+        if ( pApp->m_pBrowserWin->isFileValid( url ) )
+            tracks.push_back( PlaylistTrack( PlaylistModel::locationForUrl( url ) ) );
+    }
+
+// held back while a PlaylistLoader inserts, setLoading() picks them up
+    if ( !m_loading )
+        flushRemote( false );
+}
+
+
+
+void PlaylistWidget::slotRemoteResult( KIO::Job *job )
+{
+    if ( !m_remoteListings.contains( job ) )
+        return;
+
+// a file we couldn't play, or a host we couldn't reach, it's left out like any other
+    if ( job->error() )
+        kdDebug() << "PlaylistWidget: " << job->errorString() << endl;
+
+    m_remoteListings[job].m_done = true;
+
+    if ( !m_loading )
+        flushRemote( true );
+}
+
+
 
 void PlaylistWidget::slotGlowTimer()
 {
     if ( !isVisible() )
         return;
 
-    PlaylistItem *item = static_cast<PlaylistItem*>( currentTrack() );
+    int row = currentTrack();
 
-    if ( item != NULL )
+    if ( row != -1 )
     {
-        item->setGlowing( true );
-
         if ( mGlowCount > 120 )
         {
             mGlowAdd = -mGlowAdd;
@@ -323,8 +1141,8 @@ void PlaylistWidget::slotGlowTimer()
         {
             mGlowAdd = -mGlowAdd;
         }
-        item->setGlowCol( mGlowColor.light( mGlowCount ) );
-        repaintItem( item );
+        m_glowCol = mGlowColor.light( mGlowCount );
+        repaintTrack( row );
         mGlowCount += mGlowAdd;
     }
 }
@@ -341,29 +1159,16 @@ void PlaylistWidget::slotSetRecursive()
 
 void PlaylistWidget::slotTextChanged( const QString &str )
 {
-    QListViewItem *pVisibleItem = NULL;
-    QListViewItemIterator it( lastItem() );
-    
-    while ( *it )
-    {
-        if ( (*it)->text( 0 ).lower().contains( str.lower() ) )
-        {
-            (*it)->setVisible( true );
-            pVisibleItem = (*it);
-        }
-        else
-            (*it)->setVisible( false );
-        
-        --it;
-    }
-                
-    clearSelection();            
-    triggerUpdate();
+    m_filter = str.lower();
+    m_model.clearSelection();
+    invalidateView();
 
-    if ( pVisibleItem )
+    if ( viewCount() )
     {
-        setCurrentItem( pVisibleItem );
-        setSelected( pVisibleItem, true );
+        int row = viewToTrack( 0 );
+
+        m_model.setSelected( row, true );
+        m_model.setCurrentRow( row );
     }
 }
 
@@ -18,42 +18,86 @@
 #ifndef PLAYLISTWIDGET_H
 #define PLAYLISTWIDGET_H
 
-#include <klistview.h>
+#include "metafetcher.h"
+#include "playlistindex.h"
+#include "playlistmodel.h"
+
+#include <qcolor.h>
+#include <qmap.h>
+#include <qpixmap.h>
+#include <qpoint.h>
+#include <qscrollview.h>
+#include <qstringlist.h>
+#include <qtime.h>
+#include <qvaluelist.h>
+#include <qvaluevector.h>
+
+#include <kio/global.h>
 #include <kurl.h>
 
-class PlaylistItem;
-
-class QColor;
+class QDragEnterEvent;
 class QDragMoveEvent;
 class QDropEvent;
 class QFocusEvent;
-class QPoint;
+class QFont;
+class QMouseEvent;
+class QPainter;
+class QResizeEvent;
 class QString;
-class QStringList;
 class QTimer;
 
-class KDirLister;
+class KProgressDialog;
+
+namespace KIO
+{
+    class Job;
+}
+
+class DirScanner;
+class MetaBundle;
 
 class PlayerApp;
 extern PlayerApp *pApp;
 
 /**
+ * View for the PlaylistModel. Only the rows inside the viewport are ever
+ * painted, so the size of the playlist does not matter for drawing.
  *@author mark
  */
 
-class PlaylistWidget : public KListView
+class PlaylistWidget : public QScrollView
 {
     Q_OBJECT
     public:
         PlaylistWidget(QWidget *parent=0, const char *name=0);
         ~PlaylistWidget();
 
-        QListViewItem* currentTrack();
-        void setCurrentTrack( QListViewItem *item );
-        void unglowItems();
+        const PlaylistModel *model() const { return &m_model; }
+        int count() const { return m_model.count(); }
+
+        int currentTrack() const;
+        void setCurrentTrack( int row );
+        int currentRow() const;
+        void setCurrentRow( int row );
+        void moveCursor( int rows );
+        int visibleRows() const;
+        void ensureTrackVisible( int row );
         void triggerSignalPlay();
         void fetchMetaInfo();
-        PlaylistItem* addItem( PlaylistItem *after, KURL url );
+        MetaBundle metaInfo( int row );
+        int addItem( int after, const KURL &url );
+        int appendItem( const KURL &url ) { return addItem( count() - 1, url ); }
+        int insertTracks( int after, const QValueVector<PlaylistTrack> &tracks );
+        bool saveSnapshot( const QString &fileName ) const;
+        bool restoreSnapshot( const QString &fileName );
+        void setTitle( int row, const QString &title );
+        void removeSelected();
+        void clear();
+        void sort( bool ascending );
+        void shuffle();
+        void triggerUpdate();
+        void setLoading( bool loading );
+        bool isLoading() const { return m_loading; }
 
         void contentsDropEvent( QDropEvent* e);
 
@@ -64,28 +108,113 @@ class PlaylistWidget : public KListView
         void slotSetRecursive();
         void slotTextChanged( const QString &str );
 
+    private slots:
+        void slotUpdate();
+        void slotMetaInfoReady();
+        void slotReadFallback();
+        void slotScanFiles();
+        void slotScanFinished();
+        void slotScanProgress();
+        void slotCancelScan();
+        void slotRemoteEntries( KIO::Job *job, const KIO::UDSEntryList &entries );
+        void slotRemoteResult( KIO::Job *job );
+
         signals:
         void signalJump();
         void signalPlay();
+        void doubleClicked( int row );
+        void rightButtonPressed( int row, const QPoint &pos );
 
     private:
+        class ScanRequest
+        {
+            public:
+// ATTRIBUTES ------
+                QStringList m_dirs;
+                int m_after;
+                bool m_recursive;
+        };
+
+        class RemoteListing
+        {
+            public:
+                RemoteListing() : m_after( -1 ), m_done( false ) {}
+
+// ATTRIBUTES ------
+                int m_after;
+                QValueVector<PlaylistTrack> m_tracks;   // found and not yet inserted
+                bool m_done;
+        };
+
+        void drawContents( QPainter *p, int cx, int cy, int cw, int ch );
+        void paintRow( QPainter *p, int row, int y );
+        void viewportResizeEvent( QResizeEvent *e );
+        void fontChange( const QFont &oldFont );
+        void contentsMousePressEvent( QMouseEvent *e );
+        void contentsMouseMoveEvent( QMouseEvent *e );
+        void contentsMouseReleaseEvent( QMouseEvent *e );
+        void contentsMouseDoubleClickEvent( QMouseEvent *e );
+        void contentsDragEnterEvent( QDragEnterEvent* e );
         void contentsDragMoveEvent( QDragMoveEvent* e);
         void focusInEvent( QFocusEvent *e );
 
+        void updateView();
+        void invalidateView();
+        void modelChanged();
+        void trackChanged( int row );
+        int viewCount();
+        int viewToTrack( int viewRow );
+        int trackToView( int row );
+        int rowAt( int y );
+        void repaintTrack( int row );
+        void selectRange( int from, int to );
+        void queueMetaInfo( int row, bool urgent );
+
         void playlistDrop( KURL::List urlList );
-        PlaylistItem* playlistInsertItem( KURL srcUrl, PlaylistItem* dstItem );
-        PlaylistItem* playlistInsertDir( KURL srcUrl, PlaylistItem* dstItem );
+        void startScan( const ScanRequest &request );
+        void stopScan();
+        void listRemote( const KURL &url, int after, bool recursive );
+        void flushRemote( bool all );
 
 // ATTRIBUTES ------
-        KDirLister *m_pDirLister;
-        PlaylistItem *m_pDropCurrentItem;
-        int m_dropRecursionCounter;
+        PlaylistModel m_model;
+        PlaylistIndex m_index;
+        QValueVector<int> m_viewRows;     // track rows matching the filter, only used when m_filtered
+        QString m_filter;
+        bool m_filtered;
+        bool m_viewDirty;
+        bool m_updatePending;
+
+        int m_rowHeight;
+        QPixmap m_rowBuffer;
+        int m_anchorRow;
+        int m_pressRow;
+        QPoint m_pressPos;
+        bool m_pendingSelect;
+
+        int m_dropRow;
         bool m_dropRecursively;
 
+        DirScanner *m_pScanner;
+        int m_scanRow;                  // the scanned files go below this row
+        uint m_scanCount;
+        QTime m_scanTime;
+        KProgressDialog *m_pScanProgress;
+        QValueList<ScanRequest> m_scanQueue;    // folders dropped while the scanner was busy
+        QMap<KIO::Job*, RemoteListing> m_remoteListings;    // remote folders, DirScanner only reads local ones
+
         QTimer* mGlowTimer;
         int mGlowCount, mGlowAdd;
         QColor mGlowColor;
-        QListViewItem* m_pCurrentTrack;
+        QColor m_glowCol;
+
+        MetaFetcher *m_pMetaFetcher;
+        int m_metaCursor;               // rows above have been queued since the last change
         bool m_playlistDirty;
+        bool m_loading;                 // a PlaylistLoader is inserting, rows must not move under it
+        bool m_scanFinishPending;
+        QValueList<MetaFetcher::Job> m_fallbackJobs;    // waiting for KFileMetaInfo
+        QMap<QString, int> m_fallbackBusy;              // their locations
+        QTimer *m_pFallbackTimer;
 };
 #endif
@@ -0,0 +1,354 @@
+/***************************************************************************
+                          playobjectcreator.cpp  -  description
+                             -------------------
+    begin                : Mit Mai 14 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "playobjectcreator.h"
+#include "streamconnection.h"
+
+#include <qapplication.h>
+#include <qdeepcopy.h>
+#include <qevent.h>
+#include <qfile.h>
+#include <qstring.h>
+#include <qtimer.h>
+
+#include <kdebug.h>
+#include <kmimetype.h>
+#include <ksycoca.h>
+#include <kurl.h>
+
+#include <arts/kplayobject.h>
+#include <kmedia2.h>
+#include <trader.h>
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// posted by a thread when it has read its file, or failed to
+static const int CHECKED_EVENT = QEvent::User + 120;
+// ms a reader thread gets to finish on exit, before it is left hanging on its mount
+static const unsigned long EXIT_WAIT = 500;
+
+
+PlayObjectCreatorThread::PlayObjectCreatorThread( PlayObjectCreator *creator, const QString &path, long serial ) :
+m_pCreator( creator ),
+m_path( QDeepCopy<QString>( path ) ),
+m_serial( serial ),
+m_readable( false )
+{
+}
+
+
+
+void PlayObjectCreatorThread::run()
+{
+    const int fd = ::open( QFile::encodeName( m_path ), O_RDONLY );
+
+    if ( fd != -1 )
+    {
+// the decoder in artsd reads the same block right after, from the cache then
+        char buffer[4096];
+        m_readable = ::read( fd, buffer, sizeof( buffer ) ) > 0;
+        ::close( fd );
+    }
+
+    QMutexLocker locker( &m_mutex );
+
+    if ( m_pCreator )
+        QApplication::postEvent( m_pCreator, new QCustomEvent( CHECKED_EVENT, this ) );
+}
+
+
+
+void PlayObjectCreatorThread::abandon()
+{
+    QMutexLocker locker( &m_mutex );
+    m_pCreator = NULL;
+}
+
+
+
+
+PlayObjectCreator::PlayObjectCreator( Arts::SoundServerV2 server, QObject *parent, const char *name ) : QObject( parent, name ),
+m_server( server ),
+m_pFactory( new KDE::PlayObjectFactory( server ) ),
+m_serial( 0 ),
+m_waiting( false ),
+m_streaming( false ),
+m_pPending( NULL ),
+m_pConnection( NULL ),
+m_streamBufferSize( 0 ),
+m_streamPrefetch( 0 )
+{
+    m_pFactory->setAllowStreaming( true );
+
+// an older libamarokarts doesn't have it
+    Arts::TraderQuery query;
+    query.supports( "Interface", "Amarok::StreamBuffer" );
+    std::vector<Arts::TraderOffer> *offers = query.query();
+    m_streamBufferAvailable = !offers->empty();
+    delete offers;
+
+    connect( KSycoca::self(), SIGNAL( databaseChanged() ), this, SLOT( clearCache() ) );
+}
+
+
+
+PlayObjectCreator::~PlayObjectCreator()
+{
+    cancel();
+
+// a thread stuck on a dead mount would keep us from quitting, so it's left behind, and leaked
+    for ( PlayObjectCreatorThread *thread = m_threads.first(); thread; thread = m_threads.next() )
+    {
+        if ( thread->wait( EXIT_WAIT ) )
+            delete thread;
+        else
+            thread->abandon();
+    }
+
+    delete m_pFactory;
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void PlayObjectCreator::setStreamBuffer( long size, long prefetch )
+{
+    m_streamBufferSize = size;
+    m_streamPrefetch = prefetch;
+}
+
+
+
+void PlayObjectCreator::clearCache()
+{
+    m_implementations.clear();
+}
+
+
+
+KDE::PlayObject *PlayObjectCreator::create( const KURL &url )
+{
+// artsd went away, and with it the rest of our chain, so there's nothing to play on
+    if ( m_server.isNull() || m_server.error() )
+    {
+        clearCache();
+        return NULL;
+    }
+
+                                                  //second parameter: create BUS(true/false)
+    if ( !url.isLocalFile() )
+        return m_pFactory->createPlayObject( url, false );
+
+    const QString mimeType = KMimeType::findByURL( url, 0, true )->name();
+    const QString impl = implementation( mimeType );
+
+    if ( impl.isEmpty() )
+    {
+        kdDebug() << "PlayObjectCreator: no PlayObject for " << mimeType << endl;
+        return NULL;
+    }
+
+    KDE::PlayObject *playObject = createDirectly( impl, url.path() );
+
+    if ( playObject )
+        return playObject;
+
+// let the server choose on its own, in case the cached answer is stale
+    m_implementations.remove( mimeType );
+
+    return m_pFactory->createPlayObject( url, false );
+}
+
+
+
+void PlayObjectCreator::request( const KURL &url )
+{
+    cancel();
+
+    m_waiting = true;
+    m_streaming = !url.isLocalFile();
+    m_url = url;
+
+    if ( m_streaming && m_streamBufferAvailable && m_streamBufferSize > 0 )
+    {
+        m_pConnection = new StreamConnection( m_server, url, m_streamBufferSize, m_streamPrefetch, this );
+
+        connect( m_pConnection, SIGNAL( connected( KDE::PlayObject* ) ), this, SLOT( slotStreamConnected( KDE::PlayObject* ) ) );
+        connect( m_pConnection, SIGNAL( failed() ), this, SLOT( slotStreamFailed() ) );
+        m_pConnection->start();
+    }
+    else if ( m_streaming )
+    {
+// returns right away, KDE::PlayObject finds out the MIME type with KIO and emits playObjectCreated()
+        m_pPending = create( url );
+
+        if ( m_pPending && m_pPending->object().isNull() )
+            connect( m_pPending, SIGNAL( playObjectCreated() ), this, SLOT( slotCheckStream() ) );
+        else
+            QTimer::singleShot( 0, this, SLOT( slotCheckStream() ) );
+    }
+    else
+    {
+        PlayObjectCreatorThread *thread = new PlayObjectCreatorThread( this, url.path(), m_serial );
+        m_threads.append( thread );
+        thread->start();
+    }
+}
+
+
+
+void PlayObjectCreator::cancel()
+{
+    ++m_serial;
+    m_waiting = false;
+
+    delete m_pPending;
+    m_pPending = NULL;
+    delete m_pConnection;
+    m_pConnection = NULL;
+}
+
+
+
+void PlayObjectCreator::slotCheckStream()
+{
+// a timer of a request cancelled in the meantime
+    if ( !m_waiting || !m_streaming )
+        return;
+
+    if ( m_pPending == NULL )
+        finish( NULL );
+    else if ( !m_pPending->object().isNull() )
+    {
+        KDE::PlayObject *playObject = m_pPending;
+        m_pPending = NULL;
+        finish( playObject );
+    }
+}
+
+
+
+void PlayObjectCreator::slotStreamConnected( KDE::PlayObject *playObject )
+{
+// the connection belongs to the PlayObject now
+    m_pConnection = NULL;
+    finish( playObject );
+}
+
+
+
+void PlayObjectCreator::slotStreamFailed()
+{
+// still inside its signal, it can't be deleted right away
+    m_pConnection->deleteLater();
+    m_pConnection = NULL;
+    finish( NULL );
+}
+
+
+
+void PlayObjectCreator::customEvent( QCustomEvent *e )
+{
+    if ( e->type() != CHECKED_EVENT )
+        return;
+
+    PlayObjectCreatorThread *thread = static_cast<PlayObjectCreatorThread*>( e->data() );
+    thread->wait();
+    m_threads.removeRef( thread );
+
+    if ( thread->serial() == m_serial && m_waiting )
+    {
+        KDE::PlayObject *playObject = NULL;
+
+// the file is in the cache now, artsd won't wait for the disk long
+        if ( thread->readable() )
+            playObject = create( m_url );
+
+        if ( playObject && playObject->isNull() )
+        {
+            delete playObject;
+            playObject = NULL;
+        }
+
+        finish( playObject );
+    }
+
+    delete thread;
+}
+
+
+
+void PlayObjectCreator::finish( KDE::PlayObject *playObject )
+{
+    m_waiting = false;
+
+    if ( playObject )
+        emit ready( playObject );
+    else
+        emit failed();
+}
+
+
+
+QString PlayObjectCreator::implementation( const QString &mimeType )
+{
+    QMap<QString, QString>::Iterator it = m_implementations.find( mimeType );
+
+    if ( it != m_implementations.end() )
+        return it.data();
+
+// the same query artsd does in createPlayObjectForURL(), which takes the first offer as well
+    Arts::TraderQuery query;
+    query.supports( "Interface", "Arts::PlayObject" );
+    query.supports( "MimeType", std::string( mimeType.latin1() ) );
+    std::vector<Arts::TraderOffer> *offers = query.query();
+
+    QString impl;
+
+    if ( !offers->empty() )
+        impl = QString::fromLatin1( offers->front().interfaceName().c_str() );
+
+    delete offers;
+
+    m_implementations.insert( mimeType, impl );
+    kdDebug() << "PlayObjectCreator: " << mimeType << " is played by " << impl << endl;
+
+    return impl;
+}
+
+
+
+KDE::PlayObject *PlayObjectCreator::createDirectly( const QString &implementation, const QString &path )
+{
+    Arts::Object object = m_server.createObject( std::string( implementation.latin1() ) );
+    Arts::PlayObject_private loader = Arts::DynamicCast( object );
+
+    if ( loader.isNull() || !loader.loadMedia( std::string( QFile::encodeName( path ) ) ) )
+        return NULL;
+
+    Arts::PlayObject playObject = Arts::DynamicCast( object );
+
+    return new KDE::PlayObject( playObject, false );
+}
+
+
+#include "playobjectcreator.moc"
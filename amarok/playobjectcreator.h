@@ -0,0 +1,127 @@
+/***************************************************************************
+                          playobjectcreator.h  -  description
+                             -------------------
+    begin                : Mit Mai 14 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef PLAYOBJECTCREATOR_H
+#define PLAYOBJECTCREATOR_H
+
+#include <qmap.h>
+#include <qmutex.h>
+#include <qobject.h>
+#include <qptrlist.h>
+#include <qstring.h>
+#include <qthread.h>
+
+#include <kurl.h>
+
+#include <arts/kplayobjectfactory.h>
+#include <soundserver.h>
+
+class QCustomEvent;
+class PlayObjectCreator;
+class StreamConnection;
+
+/**
+ * Reads the start of a local file for PlayObjectCreator::request(), so a
+ * slow or hanging mount keeps a thread waiting instead of the GUI.
+ */
+
+class PlayObjectCreatorThread : public QThread
+{
+    public:
+        PlayObjectCreatorThread( PlayObjectCreator *creator, const QString &path, long serial );
+
+        long serial() const { return m_serial; }
+        bool readable() const { return m_readable; }
+        void abandon();
+
+    protected:
+        void run();
+
+    private:
+        QMutex m_mutex;
+        PlayObjectCreator *m_pCreator;  // NULL once abandoned, nobody waits for the result then
+        const QString m_path;
+        const long m_serial;
+        bool m_readable;
+};
+
+
+
+/**
+ * Creates the PlayObjects for the player. For local files it remembers
+ * which PlayObject implementation the trader chose for each MIME type, and
+ * has artsd create that one directly next time, skipping the trader query
+ * in the server. Streams are played through a StreamConnection when the
+ * stream buffer is set up and available, otherwise through a
+ * KDE::PlayObjectFactory that lives as long as this. The cache is dropped
+ * when the MIME types change, or when the sound server is gone: create()
+ * returns NULL then, there is no reconnecting to a restarted artsd.
+ * request() does the same without blocking: a local file is read by a
+ * thread first, a stream connects in the background. The result is
+ * announced with ready() or failed(), never from within request(), unless
+ * cancel() or the next request() came first.
+ *@author mark
+ */
+
+class PlayObjectCreator : public QObject
+{
+    Q_OBJECT
+    public:
+        PlayObjectCreator( Arts::SoundServerV2 server, QObject *parent = 0, const char *name = 0 );
+        ~PlayObjectCreator();
+
+        void setStreamBuffer( long size, long prefetch );
+        KDE::PlayObject *create( const KURL &url );
+        void request( const KURL &url );
+        void cancel();
+
+    public slots:
+        void clearCache();
+
+    signals:
+        void ready( KDE::PlayObject *playObject );
+        void failed();
+
+    private slots:
+        void slotCheckStream();
+        void slotStreamConnected( KDE::PlayObject *playObject );
+        void slotStreamFailed();
+
+    private:
+        void customEvent( QCustomEvent *e );
+        void finish( KDE::PlayObject *playObject );
+        QString implementation( const QString &mimeType );
+        KDE::PlayObject *createDirectly( const QString &implementation, const QString &path );
+
+// ATTRIBUTES ------
+        Arts::SoundServerV2 m_server;
+        KDE::PlayObjectFactory *m_pFactory;
+        QMap<QString, QString> m_implementations;   // MIME type -> PlayObject interface, empty if none
+
+        long m_serial;                  // of the current request, results of older ones are dropped
+        bool m_waiting;                 // a request is running
+        bool m_streaming;
+        KURL m_url;
+        KDE::PlayObject *m_pPending;    // stream PlayObject still looking for its MIME type
+        StreamConnection *m_pConnection;    // the same, through the stream buffer
+
+        long m_streamBufferSize;        // bytes, 0 for none
+        long m_streamPrefetch;
+        bool m_streamBufferAvailable;
+        QPtrList<PlayObjectCreatorThread> m_threads;
+};
+#endif
@@ -0,0 +1,328 @@
+/***************************************************************************
+                          seekindex.cpp  -  description
+                             -------------------
+    begin                : Fre Mai 16 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "seekindex.h"
+#include "tagreader.h"
+
+#include <qapplication.h>
+#include <qcstring.h>
+#include <qdatastream.h>
+#include <qdeepcopy.h>
+#include <qfile.h>
+#include <qstring.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static const Q_UINT32 INDEX_MAGIC = 0x616d7369;      // "amsi"
+static const Q_UINT32 INDEX_VERSION = 1;
+
+
+SeekIndex::SeekIndex() :
+m_length( 0 ),
+m_audioStart( 0 ),
+m_bitrate( 0 ),
+m_tocBytes( 0 )
+{
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void SeekIndex::clear()
+{
+    m_times.clear();
+    m_offsets.clear();
+    m_length = 0;
+    m_audioStart = 0;
+    m_bitrate = 0;
+    m_toc.resize( 0 );
+    m_tocBytes = 0;
+}
+
+
+
+void SeekIndex::setStream( long audioStart, int bitrate, const QByteArray &toc, long tocBytes )
+{
+    m_audioStart = audioStart;
+    m_bitrate = bitrate;
+    m_toc = toc.copy();
+    m_tocBytes = tocBytes;
+}
+
+
+
+void SeekIndex::addPoint( long ms, long offset )
+{
+    m_times.append( ms );
+    m_offsets.append( offset );
+}
+
+
+
+long SeekIndex::offsetAt( long ms ) const
+{
+    if ( isEmpty() )
+        return m_audioStart;
+
+    const uint count = m_times.count();
+    uint low = 0;
+    uint high = count - 1;
+
+// the last point at or before ms
+    while ( low < high )
+    {
+        const uint mid = ( low + high + 1 ) / 2;
+
+        if ( static_cast<long>( m_times[mid] ) <= ms )
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    if ( low + 1 >= count || ms <= static_cast<long>( m_times[low] ) )
+        return m_offsets[low];
+
+// frames between two points are about the same size, the decoder finds the next sync word anyway
+    const double part = static_cast<double>( ms - m_times[low] ) / ( m_times[low + 1] - m_times[low] );
+
+    return m_offsets[low] + static_cast<long>( part * ( m_offsets[low + 1] - m_offsets[low] ) );
+}
+
+
+
+long SeekIndex::timeAt( long offset ) const
+{
+    if ( isEmpty() )
+        return 0;
+
+    const uint count = m_offsets.count();
+    uint low = 0;
+    uint high = count - 1;
+
+    while ( low < high )
+    {
+        const uint mid = ( low + high + 1 ) / 2;
+
+        if ( static_cast<long>( m_offsets[mid] ) <= offset )
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    if ( low + 1 >= count || offset <= static_cast<long>( m_offsets[low] ) )
+        return m_times[low];
+
+    const double part = static_cast<double>( offset - m_offsets[low] ) / ( m_offsets[low + 1] - m_offsets[low] );
+
+    return m_times[low] + static_cast<long>( part * ( m_times[low + 1] - m_times[low] ) );
+}
+
+
+
+long SeekIndex::decoderSeek( long ms, long &correction ) const
+{
+    const long target = offsetAt( ms );
+    long low = 0;
+    long high = m_length / 1000;
+
+// decoderOffset() grows with the seconds, find the last one not behind the target
+    while ( low < high )
+    {
+        const long mid = ( low + high + 1 ) / 2;
+
+        if ( decoderOffset( mid ) <= target )
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    long seconds = low;
+
+    if ( seconds < m_length / 1000 && labs( decoderOffset( seconds + 1 ) - target ) < labs( decoderOffset( seconds ) - target ) )
+        ++seconds;
+
+    correction = timeAt( decoderOffset( seconds ) ) - seconds * 1000;
+
+    return seconds;
+}
+
+
+
+long SeekIndex::decoderOffset( long seconds ) const
+{
+    if ( m_toc.size() == 100 && m_length > 0 )
+    {
+// the same interpolation as SeekPoint() of the Xing SDK, which the decoder uses
+        float percent = seconds * 100000.0 / m_length;
+
+        if ( percent < 0.0 )
+            percent = 0.0;
+        if ( percent > 100.0 )
+            percent = 100.0;
+
+        const int a = QMIN( static_cast<int>( percent ), 99 );
+        const float fa = static_cast<uchar>( m_toc[a] );
+        const float fb = a < 99 ? static_cast<uchar>( m_toc[a + 1] ) : 256.0;
+        const float fx = fa + ( fb - fa ) * ( percent - a );
+
+        return m_audioStart + static_cast<long>( fx / 256.0 * m_tocBytes );
+    }
+
+// without a TOC, every frame is taken to have the bitrate of the first one
+    return m_audioStart + seconds * m_bitrate * 1000 / 8;
+}
+
+
+
+bool SeekIndex::stamp( const QString &path, uint &size, uint &mtime )
+{
+    struct stat st;
+
+    if ( ::stat( QFile::encodeName( path ), &st ) != 0 )
+        return false;
+
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+
+
+bool SeekIndex::load( const QString &fileName, const QString &path )
+{
+    clear();
+
+    QFile file( fileName );
+    uint size, mtime;
+
+    if ( !stamp( path, size, mtime ) || !file.open( IO_ReadOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    Q_UINT32 magic, version, fileSize, fileMtime, count;
+    Q_INT32 length, audioStart, bitrate, tocBytes;
+    QString indexedPath;
+
+    stream >> magic >> version;
+
+    if ( magic != INDEX_MAGIC || version != INDEX_VERSION )
+        return false;
+
+// a different file with the same hash, or the file changed since
+    stream >> indexedPath >> fileSize >> fileMtime;
+
+    if ( indexedPath != path || fileSize != size || fileMtime != mtime )
+        return false;
+
+    stream >> length >> audioStart >> bitrate >> m_toc >> tocBytes >> count;
+
+// each point takes 8 bytes, a broken count would have us reserve gigabytes
+    if ( count > ( file.size() - file.at() ) / 8 )
+    {
+        clear();
+        return false;
+    }
+
+    m_length = length;
+    m_audioStart = audioStart;
+    m_bitrate = bitrate;
+    m_tocBytes = tocBytes;
+    m_times.reserve( count );
+    m_offsets.reserve( count );
+
+    for ( uint i = 0; i < count && !stream.atEnd(); ++i )
+    {
+        Q_UINT32 ms, offset;
+        stream >> ms >> offset;
+        addPoint( ms, offset );
+    }
+
+    if ( m_times.count() != count )
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+
+bool SeekIndex::save( const QString &fileName, const QString &path ) const
+{
+    uint size, mtime;
+
+    if ( !stamp( path, size, mtime ) )
+        return false;
+
+// written aside and renamed, so a crash never leaves half an index
+    const QString tempName = fileName + ".new";
+    QFile file( tempName );
+
+    if ( !file.open( IO_WriteOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+
+    stream << INDEX_MAGIC << INDEX_VERSION;
+    stream << path << static_cast<Q_UINT32>( size ) << static_cast<Q_UINT32>( mtime );
+    stream << static_cast<Q_INT32>( m_length ) << static_cast<Q_INT32>( m_audioStart ) << static_cast<Q_INT32>( m_bitrate );
+    stream << m_toc << static_cast<Q_INT32>( m_tocBytes ) << static_cast<Q_UINT32>( m_times.count() );
+
+    for ( uint i = 0; i < m_times.count(); ++i )
+        stream << static_cast<Q_UINT32>( m_times[i] ) << static_cast<Q_UINT32>( m_offsets[i] );
+
+    file.close();
+
+    if ( file.status() != IO_Ok || ::rename( QFile::encodeName( tempName ), QFile::encodeName( fileName ) ) != 0 )
+    {
+        QFile::remove( tempName );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+SeekIndexLoader::SeekIndexLoader( QObject *receiver, const QString &path, const QString &cacheFile ) :
+m_pReceiver( receiver ),
+m_path( QDeepCopy<QString>( path ) ),
+m_cacheFile( QDeepCopy<QString>( cacheFile ) ),
+m_aborted( false )
+{
+}
+
+
+
+void SeekIndexLoader::run()
+{
+    if ( !m_index.load( m_cacheFile, m_path ) )
+    {
+        if ( TagReader::readSeekIndex( m_path, m_index, m_aborted ) )
+            m_index.save( m_cacheFile, m_path );
+        else
+            m_index.clear();
+    }
+
+    QApplication::postEvent( m_pReceiver, new QCustomEvent( EventType, this ) );
+}
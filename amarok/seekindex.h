@@ -0,0 +1,108 @@
+/***************************************************************************
+                          seekindex.h  -  description
+                             -------------------
+    begin                : Fre Mai 16 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef SEEKINDEX_H
+#define SEEKINDEX_H
+
+#include <qcstring.h>
+#include <qevent.h>
+#include <qstring.h>
+#include <qthread.h>
+#include <qvaluevector.h>
+
+class QObject;
+
+/**
+ * Byte offsets of the frames of an MP3 file at known times, about one per
+ * second, built by TagReader::readSeekIndex() from a scan over all frames.
+ * offsetAt() and timeAt() translate between the two by binary search.
+ *
+ * aRts' MP3 decoder only seeks to whole seconds, and guesses the offset: with
+ * the TOC of a Xing header if there is one, from the bitrate of the first
+ * frame otherwise. For VBR files without a Xing header that's far off.
+ * decoderSeek() picks the second that makes the decoder land closest to the
+ * wanted time, and tells how far the decoder's idea of the time is off
+ * there, so the player can show the right position anyway.
+ *@author mark
+ */
+
+class SeekIndex
+{
+    public:
+        SeekIndex();
+
+        bool isEmpty() const { return m_times.isEmpty(); }
+        long length() const { return m_length; }        // ms
+
+        long offsetAt( long ms ) const;
+        long timeAt( long offset ) const;
+        long decoderSeek( long ms, long &correction ) const;
+
+        void clear();
+        void setStream( long audioStart, int bitrate, const QByteArray &toc, long tocBytes );
+        void addPoint( long ms, long offset );
+        void setLength( long ms ) { m_length = ms; }
+
+        bool load( const QString &fileName, const QString &path );
+        bool save( const QString &fileName, const QString &path ) const;
+
+    private:
+        long decoderOffset( long seconds ) const;
+        static bool stamp( const QString &path, uint &size, uint &mtime );
+
+// ATTRIBUTES ------
+        QValueVector<uint> m_times;         // ms, ascending
+        QValueVector<uint> m_offsets;       // bytes, of the frame starting at the time
+        long m_length;
+
+        long m_audioStart;                  // first frame, including a Xing header frame
+        int m_bitrate;                      // of the first frame, kbit/s
+        QByteArray m_toc;                   // of the Xing header, 100 entries or none
+        long m_tocBytes;
+};
+
+
+
+/**
+ * Loads the SeekIndex of a file from its cache file, or builds and saves
+ * it there, in the background. A QCustomEvent of type EventType with the
+ * thread as data is posted to the receiver when done.
+ */
+
+class SeekIndexLoader : public QThread
+{
+    public:
+        enum { EventType = QEvent::User + 130 };
+
+        SeekIndexLoader( QObject *receiver, const QString &path, const QString &cacheFile );
+
+        const QString &path() const { return m_path; }
+        const SeekIndex &index() const { return m_index; }
+        void abort() { m_aborted = true; }
+        bool isAborted() const { return m_aborted; }
+
+    protected:
+        void run();
+
+    private:
+        QObject *m_pReceiver;
+        const QString m_path;
+        const QString m_cacheFile;
+        SeekIndex m_index;
+        volatile bool m_aborted;
+};
+#endif
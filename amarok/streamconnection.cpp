@@ -0,0 +1,270 @@
+/***************************************************************************
+                          streamconnection.cpp  -  description
+                             -------------------
+    begin                : Don Mai 15 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "streamconnection.h"
+
+#include <qstring.h>
+#include <qtimer.h>
+
+#include <kdebug.h>
+#include <kio/job.h>
+
+#include <connect.h>
+
+#include <string>
+
+// ms between two looks at the source and the buffer
+static const int WATCH_INTERVAL = 1000;
+// ms to wait before the first reconnect, doubled with each further one
+static const int RECONNECT_DELAY = 500;
+// reconnects in a row without getting any data, before we let the stream end
+static const int MAX_ATTEMPTS = 5;
+
+
+StreamConnection::StreamConnection( Arts::SoundServerV2 server, const KURL &url, long bufferSize, long prefetch,
+                                    QObject *parent, const char *name ) : QObject( parent, name ),
+m_server( server ),
+m_url( url ),
+m_bufferSize( bufferSize ),
+m_prefetch( prefetch ),
+m_pJob( NULL ),
+m_source( Arts::KIOInputStream::null() ),
+m_buffer( Amarok::StreamBuffer::null() ),
+m_attempts( 0 ),
+m_reconnects( 0 ),
+m_received( 0 ),
+m_sourceStart( 0 ),
+m_fill( 0.0 ),
+m_underruns( 0 ),
+m_buffering( true )
+{
+    m_pWatchTimer = new QTimer( this );
+    connect( m_pWatchTimer, SIGNAL( timeout() ), this, SLOT( slotWatch() ) );
+}
+
+
+
+StreamConnection::~StreamConnection()
+{
+    if ( m_pJob )
+        m_pJob->kill();
+
+    closeSource();
+    m_buffer = Amarok::StreamBuffer::null();
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+StreamConnection *StreamConnection::of( KDE::PlayObject *playObject )
+{
+    if ( playObject == NULL )
+        return NULL;
+
+    return static_cast<StreamConnection*>( playObject->child( 0, "StreamConnection", false ) );
+}
+
+
+
+void StreamConnection::start()
+{
+    m_pJob = KIO::mimetype( m_url, false );
+
+    connect( m_pJob, SIGNAL( result( KIO::Job* ) ), this, SLOT( slotMimetype( KIO::Job* ) ) );
+    connect( m_pJob, SIGNAL( redirection( KIO::Job*, const KURL& ) ), this, SLOT( slotRedirection( KIO::Job*, const KURL& ) ) );
+}
+
+
+
+void StreamConnection::slotRedirection( KIO::Job*, const KURL &url )
+{
+    kdDebug() << "StreamConnection: redirected to " << url.prettyURL() << endl;
+    m_url = url;
+}
+
+
+
+void StreamConnection::slotMimetype( KIO::Job *job )
+{
+    m_pJob = NULL;
+
+    if ( job->error() )
+    {
+        kdDebug() << "StreamConnection: " << job->errorString() << endl;
+        emit failed();
+        return;
+    }
+
+    const QString mimeType = static_cast<KIO::MimetypeJob*>( job )->mimetype();
+
+    m_buffer = Arts::DynamicCast( m_server.createObject( "Amarok::StreamBuffer" ) );
+
+    if ( m_buffer.isNull() )
+    {
+        emit failed();
+        return;
+    }
+
+    m_buffer.bufferSize( m_bufferSize );
+    m_buffer.prefetch( m_prefetch );
+
+    Arts::PlayObject playObject = m_server.createPlayObjectForStream( m_buffer, std::string( mimeType.latin1() ), false );
+
+    if ( playObject.isNull() || !openSource() )
+    {
+        emit failed();
+        return;
+    }
+
+    m_buffer.streamStart();
+    m_pWatchTimer->start( WATCH_INTERVAL );
+
+    KDE::PlayObject *pPlayObject = new KDE::PlayObject( playObject, true );
+
+// from now on we live as long as the PlayObject
+    if ( parent() )
+        parent()->removeChild( this );
+    pPlayObject->insertChild( this );
+
+    emit connected( pPlayObject );
+}
+
+
+
+void StreamConnection::slotWatch()
+{
+// the source is in our process, asking it is cheap
+    if ( !m_source.isNull() && m_source.eof() )
+    {
+        const long size = m_source.size();
+
+        if ( size > 0 )
+        {
+            const long got = m_buffer.received() - m_sourceStart;
+
+            if ( got < size )
+                kdDebug() << "StreamConnection: " << m_url.prettyURL() << " broke off after " << got << " of " << size << " bytes" << endl;
+
+            closeSource();
+            playOut();
+        }
+        else
+        {
+            kdDebug() << "StreamConnection: " << m_url.prettyURL() << " broke off" << endl;
+            sourceLost();
+        }
+
+        if ( !m_pWatchTimer->isActive() )
+            return;
+    }
+
+    const long received = m_buffer.received();
+
+    if ( received != m_received )
+    {
+        m_received = received;
+        m_attempts = 0;
+    }
+
+    const long underruns = m_buffer.underruns();
+    const bool buffering = m_buffer.buffering();
+    m_fill = m_buffer.fill();
+
+    if ( underruns != m_underruns || buffering != m_buffering )
+    {
+        if ( underruns != m_underruns )
+            kdDebug() << "StreamConnection: underrun " << underruns << ", " << m_reconnects << " reconnects" << endl;
+
+        m_underruns = underruns;
+        m_buffering = buffering;
+        emit statusChanged();
+    }
+}
+
+
+
+void StreamConnection::slotReconnect()
+{
+    if ( !m_source.isNull() || !m_pWatchTimer->isActive() )
+        return;
+
+    ++m_reconnects;
+
+// a source that can't even be opened counts as one that broke off right away
+    if ( !openSource() )
+        sourceLost();
+}
+
+
+
+void StreamConnection::sourceLost()
+{
+    closeSource();
+
+    if ( ++m_attempts > MAX_ATTEMPTS )
+    {
+        kdDebug() << "StreamConnection: giving up" << endl;
+        playOut();
+        return;
+    }
+
+    QTimer::singleShot( RECONNECT_DELAY << ( m_attempts - 1 ), this, SLOT( slotReconnect() ) );
+}
+
+
+
+void StreamConnection::playOut()
+{
+    kdDebug() << "StreamConnection: playing out the buffer" << endl;
+    m_buffer.finish();
+    m_pWatchTimer->stop();
+}
+
+
+
+bool StreamConnection::openSource()
+{
+    m_source = Arts::KIOInputStream();
+
+    if ( !m_source.openURL( std::string( m_url.url().latin1() ) ) )
+    {
+        m_source = Arts::KIOInputStream::null();
+        return false;
+    }
+
+    m_sourceStart = m_buffer.received();
+    Arts::connect( m_source, "outdata", m_buffer, "indata" );
+    m_source.streamStart();
+
+    return true;
+}
+
+
+
+void StreamConnection::closeSource()
+{
+    if ( m_source.isNull() )
+        return;
+
+    Arts::disconnect( m_source, "outdata", m_buffer, "indata" );
+    m_source.streamEnd();
+    m_source = Arts::KIOInputStream::null();
+}
+
+
+#include "streamconnection.moc"
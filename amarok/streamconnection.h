@@ -0,0 +1,104 @@
+/***************************************************************************
+                          streamconnection.h  -  description
+                             -------------------
+    begin                : Don Mai 15 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef STREAMCONNECTION_H
+#define STREAMCONNECTION_H
+
+#include "amarokarts/amarokarts.h"
+
+#include <qobject.h>
+
+#include <kurl.h>
+
+#include <arts/artskde.h>
+#include <arts/kplayobject.h>
+#include <soundserver.h>
+
+class QTimer;
+
+namespace KIO
+{
+    class Job;
+}
+
+/**
+ * Plays a network stream through an Amarok::StreamBuffer in artsd. The data
+ * comes from a KIOInputStream in our process. When a live stream, one
+ * without a known length, ends or breaks off, a new one is connected to the
+ * buffer while it plays on. Only after a few failed attempts in a row the
+ * buffer is told to play out and finish. A source of known length, a file
+ * on a web server, is never reconnected: it can't be resumed where it broke
+ * off, and starting over would play it again, so the buffer plays out.
+ * Once connected() is emitted, the StreamConnection is a child of the
+ * PlayObject and goes away with it.
+ *@author mark
+ */
+
+class StreamConnection : public QObject
+{
+    Q_OBJECT
+    public:
+        StreamConnection( Arts::SoundServerV2 server, const KURL &url, long bufferSize, long prefetch,
+                          QObject *parent = 0, const char *name = 0 );
+        ~StreamConnection();
+
+        static StreamConnection *of( KDE::PlayObject *playObject );
+
+        void start();
+
+        float fill() const { return m_fill; }
+        long underruns() const { return m_underruns; }
+        bool buffering() const { return m_buffering; }
+        int reconnects() const { return m_reconnects; }
+
+    signals:
+        void connected( KDE::PlayObject *playObject );
+        void failed();
+        void statusChanged();
+
+    private slots:
+        void slotMimetype( KIO::Job *job );
+        void slotRedirection( KIO::Job *job, const KURL &url );
+        void slotWatch();
+        void slotReconnect();
+
+    private:
+        bool openSource();
+        void closeSource();
+        void sourceLost();
+        void playOut();
+
+// ATTRIBUTES ------
+        Arts::SoundServerV2 m_server;
+        KURL m_url;                     // after redirections, reconnects go there directly
+        long m_bufferSize;
+        long m_prefetch;
+
+        KIO::Job *m_pJob;               // looking for the MIME type
+        Arts::KIOInputStream m_source;
+        Amarok::StreamBuffer m_buffer;
+        QTimer *m_pWatchTimer;
+
+        int m_attempts;                 // reconnects since data last came in
+        int m_reconnects;
+        long m_received;
+        long m_sourceStart;             // m_buffer.received() when the current source was opened
+        float m_fill;
+        long m_underruns;
+        bool m_buffering;
+};
+#endif
@@ -0,0 +1,66 @@
+/***************************************************************************
+                          stringpool.cpp  -  description
+                             -------------------
+    begin                : Don Mai 8 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "stringpool.h"
+
+#include <qmap.h>
+#include <qstring.h>
+#include <qvaluevector.h>
+
+
+StringPool::StringPool()
+{
+    clear();
+}
+
+
+
+StringPool::~StringPool()
+{
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+uint StringPool::intern( const QString &str )
+{
+    if ( str.isEmpty() )
+        return 0;
+
+    QMap<QString, uint>::Iterator it = m_ids.find( str );
+
+    if ( it != m_ids.end() )
+        return it.data();
+
+    const uint id = m_strings.count();
+
+// the map and the vector share the string data, so each string is stored only once
+    m_strings.push_back( str );
+    m_ids.insert( str, id );
+
+    return id;
+}
+
+
+
+void StringPool::clear()
+{
+    m_strings.clear();
+    m_ids.clear();
+    m_strings.push_back( QString::fromLatin1( "" ) );
+}
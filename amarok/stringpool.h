@@ -0,0 +1,48 @@
+/***************************************************************************
+                          stringpool.h  -  description
+                             -------------------
+    begin                : Don Mai 8 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <qmap.h>
+#include <qstring.h>
+#include <qvaluevector.h>
+
+/**
+ * Keeps every distinct string once and hands out small ids for it. Used for
+ * artist, album and genre, which repeat over and over in a playlist.
+ * Id 0 always stands for the empty string.
+ *@author mark
+ */
+
+class StringPool
+{
+    public:
+        StringPool();
+        ~StringPool();
+
+        uint intern( const QString &str );
+        const QString &string( uint id ) const { return m_strings[id]; }
+        uint count() const { return m_strings.count(); }
+        void clear();
+
+    private:
+// ATTRIBUTES ------
+        QValueVector<QString> m_strings;
+        QMap<QString, uint> m_ids;
+};
+#endif
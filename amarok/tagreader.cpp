@@ -0,0 +1,833 @@
+/***************************************************************************
+                          tagreader.cpp  -  description
+                             -------------------
+    begin                : Die Mai 6 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "tagreader.h"
+#include "metabundle.h"
+#include "seekindex.h"
+
+#include <qcstring.h>
+#include <qfile.h>
+#include <qstring.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// we never look at more than this from the head of a file, big cover images are just skipped
+static const uint MAX_HEAD = 256 * 1024;
+// the first MPEG frame must be found within this range behind the ID3v2 tag
+static const uint MAX_SYNC = 64 * 1024;
+// the last Ogg page must be found within this range before the end of the file
+static const uint MAX_TAIL = 64 * 1024;
+// the frame scan for the SeekIndex reads this much at a time
+static const uint SCAN_CHUNK = 64 * 1024;
+// ms between two points of a SeekIndex
+static const long SEEK_POINT_INTERVAL = 1000;
+
+static const char * const id3Genres[] =
+{
+    "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop",
+    "Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B", "Rap",
+    "Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska", "Death Metal", "Pranks",
+    "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk", "Fusion", "Trance",
+    "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+    "AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock",
+    "Ethnic", "Gothic", "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream",
+    "Southern Rock", "Comedy", "Cult", "Gangsta", "Top 40", "Christian Rap", "Pop/Funk", "Jungle",
+    "Native American", "Cabaret", "New Wave", "Psychadelic", "Rave", "Showtunes", "Trailer", "Lo-Fi",
+    "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock",
+    "Folk", "Folk-Rock", "National Folk", "Swing", "Fast Fusion", "Bebob", "Latin", "Revival",
+    "Celtic", "Bluegrass", "Avantgarde", "Gothic Rock", "Progressive Rock", "Psychedelic Rock", "Symphonic Rock", "Slow Rock",
+    "Big Band", "Chorus", "Easy Listening", "Acoustic", "Humour", "Speech", "Chanson", "Opera",
+    "Chamber Music", "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove", "Satire", "Slow Jam",
+    "Club", "Tango", "Samba", "Folklore", "Ballad", "Power Ballad", "Rhythmic Soul", "Freestyle",
+    "Duet", "Punk Rock", "Drum Solo", "A capella", "Euro-House", "Dance Hall"
+};
+
+static const int id3GenreCount = sizeof( id3Genres ) / sizeof( id3Genres[0] );
+
+
+// one decoded MPEG audio frame header
+struct MpegHeader
+{
+    bool mpeg1;
+    bool mono;
+    int layer;
+    int bitrate;            // kbit/s
+    int sampleRate;
+    int samplesPerFrame;
+    int frameLength;        // bytes, including the header
+};
+
+
+static uint be32( const uchar *p )
+{
+    return ( p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+
+static uint le32( const uchar *p )
+{
+    return ( p[3] << 24 ) | ( p[2] << 16 ) | ( p[1] << 8 ) | p[0];
+}
+
+
+static uint syncsafe( const uchar *p )
+{
+    return ( ( p[0] & 0x7f ) << 21 ) | ( ( p[1] & 0x7f ) << 14 ) | ( ( p[2] & 0x7f ) << 7 ) | ( p[3] & 0x7f );
+}
+
+
+static bool parseMpegHeader( const uchar *p, MpegHeader &header )
+{
+    static const int bitrates[5][16] =
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },  // MPEG1 layer I
+        { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },  // MPEG1 layer II
+        { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 0 },  // MPEG1 layer III
+        { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },  // MPEG2/2.5 layer I
+        { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 }   // MPEG2/2.5 layer II + III
+    };
+    static const int sampleRates[3] = { 44100, 48000, 32000 };
+
+    if ( p[0] != 0xff || ( p[1] & 0xe0 ) != 0xe0 )
+        return false;
+
+    const int version = ( p[1] >> 3 ) & 3;          // 0 = MPEG2.5, 1 = reserved, 2 = MPEG2, 3 = MPEG1
+    const int layer = ( p[1] >> 1 ) & 3;            // 1 = layer III, 2 = layer II, 3 = layer I
+    const int bitrateIndex = p[2] >> 4;
+    const int rateIndex = ( p[2] >> 2 ) & 3;
+
+// free format streams have no bitrate in the header, we don't bother with them
+    if ( version == 1 || layer == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3 )
+        return false;
+
+    header.mpeg1 = ( version == 3 );
+    header.mono = ( ( p[3] >> 6 ) == 3 );
+    header.layer = 4 - layer;
+
+    if ( header.mpeg1 )
+        header.bitrate = bitrates[ header.layer - 1 ][ bitrateIndex ];
+    else
+        header.bitrate = bitrates[ header.layer == 1 ? 3 : 4 ][ bitrateIndex ];
+
+    header.sampleRate = sampleRates[ rateIndex ] >> ( header.mpeg1 ? 0 : ( version == 2 ? 1 : 2 ) );
+
+    const int padding = ( p[2] >> 1 ) & 1;
+
+    if ( header.layer == 1 )
+    {
+        header.samplesPerFrame = 384;
+        header.frameLength = ( 12 * header.bitrate * 1000 / header.sampleRate + padding ) * 4;
+    }
+    else
+    {
+        header.samplesPerFrame = ( header.layer == 3 && !header.mpeg1 ) ? 576 : 1152;
+        header.frameLength = header.samplesPerFrame / 8 * header.bitrate * 1000 / header.sampleRate + padding;
+    }
+
+    return true;
+}
+
+
+// Xing or VBRI header in the first frame, as found in VBR files
+struct VbrHeader
+{
+    uint frames;            // 0 if unknown
+    uint bytes;             // 0 if unknown
+    const uchar *toc;       // 100 entries, only Xing has one
+};
+
+
+// the first frame within size bytes, size if there is none
+static uint findFrame( const uchar *d, uint size, MpegHeader &header )
+{
+    uint pos;
+
+    for ( pos = 0; pos + 4 <= size; ++pos )
+    {
+        if ( !parseMpegHeader( d + pos, header ) )
+            continue;
+
+// a sync word in garbage is not a frame, so insist on a valid successor where we can check it
+        MpegHeader next;
+        const uint nextPos = pos + header.frameLength;
+
+        if ( nextPos + 4 > size || parseMpegHeader( d + nextPos, next ) )
+            return pos;
+    }
+
+    return size;
+}
+
+
+static bool parseVbrHeader( const uchar *d, uint size, uint pos, const MpegHeader &header, VbrHeader &vbr )
+{
+    const uint sideInfo = header.mpeg1 ? ( header.mono ? 17 : 32 ) : ( header.mono ? 9 : 17 );
+    const uint xing = pos + 4 + sideInfo;
+    const uint vbri = pos + 4 + 32;
+
+    vbr.frames = 0;
+    vbr.bytes = 0;
+    vbr.toc = 0;
+
+    if ( xing + 16 <= size && ( !memcmp( d + xing, "Xing", 4 ) || !memcmp( d + xing, "Info", 4 ) ) )
+    {
+        const uint flags = be32( d + xing + 4 );
+        uint field = xing + 8;
+
+        if ( flags & 0x1 )
+        {
+            vbr.frames = be32( d + field );
+            field += 4;
+        }
+        if ( flags & 0x2 )
+        {
+            vbr.bytes = be32( d + field );
+            field += 4;
+        }
+        if ( ( flags & 0x4 ) && field + 100 <= size )
+            vbr.toc = d + field;
+
+        return true;
+    }
+
+    if ( vbri + 18 <= size && !memcmp( d + vbri, "VBRI", 4 ) )
+    {
+        vbr.bytes = be32( d + vbri + 10 );
+        vbr.frames = be32( d + vbri + 14 );
+        return true;
+    }
+
+    return false;
+}
+
+
+// removes the 0x00 that the ID3v2 unsynchronisation scheme inserts after every 0xff
+static void deunsync( QByteArray &data )
+{
+    uint j = 0;
+
+    for ( uint i = 0; i < data.size(); ++i )
+    {
+        data[j++] = data[i];
+
+        if ( static_cast<uchar>( data[i] ) == 0xff && i + 1 < data.size() && data[i + 1] == 0 )
+            ++i;
+    }
+
+    data.resize( j );
+}
+
+
+// ID3v1 fields are padded with zeros or spaces
+static QString latin1Field( const char *data, uint max )
+{
+    uint length = 0;
+
+    while ( length < max && data[length] )
+        ++length;
+
+    return QString::fromLatin1( data, length ).stripWhiteSpace();
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+bool TagReader::read( const QString &path, MetaBundle &bundle )
+{
+    const QString lower = path.lower();
+    const bool mp3 = lower.endsWith( ".mp3" );
+    const bool ogg = lower.endsWith( ".ogg" );
+
+    if ( !mp3 && !ogg )
+        return false;
+
+    const int fd = ::open( QFile::encodeName( path ), O_RDONLY );
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat st;
+    bool ok = false;
+
+    if ( ::fstat( fd, &st ) == 0 && st.st_size > 0 )
+        ok = mp3 ? readMp3( fd, st.st_size, bundle ) : readOgg( fd, st.st_size, bundle );
+
+    ::close( fd );
+    return ok;
+}
+
+
+
+bool TagReader::readAt( int fd, long offset, QByteArray &buffer )
+{
+    return ::pread( fd, buffer.data(), buffer.size(), offset ) == static_cast<ssize_t>( buffer.size() );
+}
+
+
+
+bool TagReader::readMp3( int fd, long size, MetaBundle &bundle )
+{
+    QByteArray head( QMIN( size, static_cast<long>( MAX_HEAD ) ) );
+
+    if ( !readAt( fd, 0, head ) )
+        return false;
+
+    const long audioStart = readId3v2( head, bundle );
+    readId3v1( fd, size, bundle );
+
+    if ( audioStart >= size )
+        return true;
+
+// the tag can be bigger than what we read, so the audio gets a buffer of its own
+    QByteArray audio( QMIN( size - audioStart, static_cast<long>( MAX_SYNC ) ) );
+
+    if ( !readAt( fd, audioStart, audio ) )
+        return true;
+
+    const uchar *d = reinterpret_cast<const uchar*>( audio.data() );
+    MpegHeader header;
+    const uint pos = findFrame( d, audio.size(), header );
+
+    if ( pos + 4 > audio.size() )
+        return true;
+
+    bundle.m_sampleRate = header.sampleRate;
+
+// VBR files carry the number of frames in a Xing (or VBRI) header inside the first frame
+    VbrHeader vbr;
+    parseVbrHeader( d, audio.size(), pos, header, vbr );
+
+    const uint frames = vbr.frames;
+    const uint bytes = vbr.bytes;
+
+    if ( frames )
+    {
+        const double length = static_cast<double>( frames ) * header.samplesPerFrame / header.sampleRate;
+
+        bundle.m_length = static_cast<int>( length );
+
+        if ( bytes && length > 0 )
+            bundle.m_bitrate = static_cast<int>( bytes * 8.0 / length / 1000 );
+        else
+            bundle.m_bitrate = header.bitrate;
+    }
+    else
+    {
+        const long audioBytes = size - audioStart - pos;
+
+        bundle.m_bitrate = header.bitrate;
+        bundle.m_length = static_cast<int>( audioBytes * 8.0 / ( header.bitrate * 1000 ) );
+    }
+
+    return true;
+}
+
+
+
+bool TagReader::readSeekIndex( const QString &path, SeekIndex &index, const volatile bool &abort )
+{
+    index.clear();
+
+    if ( !path.lower().endsWith( ".mp3" ) )
+        return false;
+
+    const int fd = ::open( QFile::encodeName( path ), O_RDONLY );
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat st;
+    bool ok = false;
+
+    if ( ::fstat( fd, &st ) == 0 && st.st_size > 0 )
+        ok = scanMp3( fd, st.st_size, index, abort );
+
+    ::close( fd );
+    return ok;
+}
+
+
+
+bool TagReader::scanMp3( int fd, long size, SeekIndex &index, const volatile bool &abort )
+{
+    QByteArray head( QMIN( size, static_cast<long>( MAX_HEAD ) ) );
+    MetaBundle bundle;
+
+    if ( !readAt( fd, 0, head ) )
+        return false;
+
+    const long audioStart = readId3v2( head, bundle );
+
+    if ( audioStart >= size )
+        return false;
+
+    QByteArray chunk( QMIN( size - audioStart, static_cast<long>( SCAN_CHUNK ) ) );
+
+    if ( !readAt( fd, audioStart, chunk ) )
+        return false;
+
+    const uchar *d = reinterpret_cast<const uchar*>( chunk.data() );
+    MpegHeader header;
+    const uint pos = findFrame( d, chunk.size(), header );
+
+    if ( pos + 4 > chunk.size() )
+        return false;
+
+    VbrHeader vbr;
+    QByteArray toc;
+    long offset = audioStart + pos;
+
+    if ( parseVbrHeader( d, chunk.size(), pos, header, vbr ) )
+    {
+        if ( vbr.toc )
+            toc.duplicate( reinterpret_cast<const char*>( vbr.toc ), 100 );
+
+// the header frame is silent and not played, the music starts behind it
+        offset += header.frameLength;
+    }
+
+    index.setStream( audioStart + pos, header.bitrate, toc, vbr.bytes ? vbr.bytes : size - audioStart - pos );
+
+    chunk.resize( SCAN_CHUNK );
+    long chunkStart = 0;
+    long chunkLength = 0;
+    double samples = 0.0;
+    long nextPoint = 0;
+
+    while ( offset + 4 <= size && !abort )
+    {
+        if ( offset + 4 > chunkStart + chunkLength )
+        {
+            chunkStart = offset;
+            chunkLength = ::pread( fd, chunk.data(), chunk.size(), offset );
+
+            if ( chunkLength < 4 )
+                break;
+        }
+
+        MpegHeader frame;
+
+// lost sync, a broken frame or the tag at the end, so the next frame is looked for byte by byte
+        if ( !parseMpegHeader( reinterpret_cast<const uchar*>( chunk.data() ) + ( offset - chunkStart ), frame ) ||
+             frame.sampleRate != header.sampleRate )
+        {
+            ++offset;
+            continue;
+        }
+
+        const long ms = static_cast<long>( samples * 1000.0 / frame.sampleRate );
+
+        if ( ms >= nextPoint )
+        {
+            index.addPoint( ms, offset );
+            nextPoint = ms + SEEK_POINT_INTERVAL;
+        }
+
+        samples += frame.samplesPerFrame;
+        offset += frame.frameLength;
+    }
+
+    index.setLength( static_cast<long>( samples * 1000.0 / header.sampleRate ) );
+
+    return !abort && !index.isEmpty();
+}
+
+
+
+long TagReader::readId3v2( const QByteArray &head, MetaBundle &bundle )
+{
+    const uchar *d = reinterpret_cast<const uchar*>( head.data() );
+
+    if ( head.size() < 10 || memcmp( d, "ID3", 3 ) )
+        return 0;
+
+    const int version = d[3];
+    const int flags = d[5];
+    const uint size = syncsafe( d + 6 );
+    const long tagSize = 10 + size + ( ( flags & 0x10 ) ? 10 : 0 );
+
+// version 2.2 with the compression flag set has no defined compression scheme
+    if ( version < 2 || version > 4 || ( version == 2 && ( flags & 0x40 ) ) )
+        return tagSize;
+
+    QByteArray tag;
+    tag.duplicate( head.data() + 10, QMIN( head.size() - 10, size ) );
+
+// 2.2 and 2.3 unsynchronise the whole tag, 2.4 does it per frame
+    if ( ( flags & 0x80 ) && version < 4 )
+        deunsync( tag );
+
+    uint pos = 0;
+
+    if ( ( flags & 0x40 ) && tag.size() >= 4 )
+    {
+        const uchar *ext = reinterpret_cast<const uchar*>( tag.data() );
+        const uint extSize = ( version == 3 ) ? be32( ext ) : syncsafe( ext );
+
+// a broken size would wrap around below and send us far past the end of the tag
+        if ( extSize > tag.size() - ( version == 3 ? 4 : 0 ) )
+            return tagSize;
+
+        pos = ( version == 3 ) ? 4 + extSize : extSize;
+    }
+
+    const uint headerSize = ( version == 2 ) ? 6 : 10;
+
+    while ( tag.size() >= headerSize && pos <= tag.size() - headerSize )
+    {
+        const uchar *f = reinterpret_cast<const uchar*>( tag.data() + pos );
+
+// the padding behind the last frame
+        if ( !f[0] )
+            break;
+
+        QCString id;
+        uint frameSize;
+        int frameFlags = 0;
+
+        if ( version == 2 )
+        {
+            id = QCString( reinterpret_cast<const char*>( f ), 4 );
+            frameSize = ( f[3] << 16 ) | ( f[4] << 8 ) | f[5];
+        }
+        else
+        {
+            id = QCString( reinterpret_cast<const char*>( f ), 5 );
+            frameSize = ( version == 4 ) ? syncsafe( f + 4 ) : be32( f + 4 );
+            frameFlags = f[9];
+        }
+
+        pos += headerSize;
+
+        if ( frameSize > tag.size() - pos )
+            break;
+
+        const uint framePos = pos;
+        pos += frameSize;
+
+        QString *field = 0;
+
+        if ( id == "TIT2" || id == "TT2" )
+            field = &bundle.m_title;
+        else if ( id == "TPE1" || id == "TP1" )
+            field = &bundle.m_artist;
+        else if ( id == "TALB" || id == "TAL" )
+            field = &bundle.m_album;
+        else if ( id == "TCON" || id == "TCO" )
+            field = &bundle.m_genre;
+
+        if ( !field || !field->isEmpty() )
+            continue;
+
+// compressed and encrypted frames are skipped
+        if ( version == 3 && ( frameFlags & 0xc0 ) )
+            continue;
+        if ( version == 4 && ( frameFlags & 0x0c ) )
+            continue;
+
+        QByteArray data;
+        data.duplicate( tag.data() + framePos, frameSize );
+
+        if ( version == 4 )
+        {
+            if ( ( frameFlags & 0x02 ) || ( flags & 0x80 ) )
+                deunsync( data );
+
+// data length indicator
+            if ( ( frameFlags & 0x01 ) && data.size() >= 4 )
+            {
+                *field = id3Text( data.data() + 4, data.size() - 4 );
+                continue;
+            }
+        }
+
+        *field = id3Text( data.data(), data.size() );
+    }
+
+    bundle.m_genre = id3Genre( bundle.m_genre );
+
+    return tagSize;
+}
+
+
+
+void TagReader::readId3v1( int fd, long size, MetaBundle &bundle )
+{
+    if ( size < 128 )
+        return;
+
+    QByteArray tag( 128 );
+
+    if ( !readAt( fd, size - 128, tag ) || memcmp( tag.data(), "TAG", 3 ) )
+        return;
+
+// ID3v2 wins, v1 only fills the gaps
+    if ( bundle.m_title.isEmpty() )
+        bundle.m_title = latin1Field( tag.data() + 3, 30 );
+    if ( bundle.m_artist.isEmpty() )
+        bundle.m_artist = latin1Field( tag.data() + 33, 30 );
+    if ( bundle.m_album.isEmpty() )
+        bundle.m_album = latin1Field( tag.data() + 63, 30 );
+
+    const int genre = static_cast<uchar>( tag[127] );
+
+    if ( bundle.m_genre.isEmpty() && genre < id3GenreCount )
+        bundle.m_genre = id3Genres[genre];
+}
+
+
+
+QString TagReader::id3Text( const char *data, uint length )
+{
+    if ( length < 1 )
+        return QString::null;
+
+    const uchar encoding = data[0];
+    const uchar *d = reinterpret_cast<const uchar*>( data + 1 );
+    --length;
+
+    QString str;
+
+    if ( encoding == 1 || encoding == 2 )
+    {
+// UTF-16 with byte order mark, or UTF-16BE without
+        bool bigEndian = ( encoding == 2 );
+        uint i = 0;
+
+        if ( encoding == 1 && length >= 2 )
+        {
+            if ( d[0] == 0xfe && d[1] == 0xff )
+            {
+                bigEndian = true;
+                i = 2;
+            }
+            else if ( d[0] == 0xff && d[1] == 0xfe )
+                i = 2;
+        }
+
+        for ( ; i + 1 < length; i += 2 )
+        {
+            const ushort c = bigEndian ? ( d[i] << 8 ) | d[i + 1] : ( d[i + 1] << 8 ) | d[i];
+
+            if ( !c )
+                break;
+
+            str += QChar( c );
+        }
+    }
+    else
+    {
+        uint end = 0;
+
+        while ( end < length && d[end] )
+            ++end;
+
+        if ( encoding == 3 )
+            str = QString::fromUtf8( reinterpret_cast<const char*>( d ), end );
+        else
+            str = QString::fromLatin1( reinterpret_cast<const char*>( d ), end );
+    }
+
+    return str.stripWhiteSpace();
+}
+
+
+
+QString TagReader::id3Genre( const QString &genre )
+{
+// genres may be given as "(17)", "(17)Rock" or plain "17", all refering to the ID3v1 list
+    QString number = genre;
+
+    if ( genre.startsWith( "(" ) )
+    {
+        const int close = genre.find( ')' );
+
+        if ( close < 0 )
+            return genre;
+        if ( close + 1 < static_cast<int>( genre.length() ) )
+            return genre.mid( close + 1 );
+
+        number = genre.mid( 1, close - 1 );
+    }
+
+    bool ok;
+    const int index = number.toInt( &ok );
+
+    if ( ok && index >= 0 && index < id3GenreCount )
+        return id3Genres[index];
+
+    return genre;
+}
+
+
+
+bool TagReader::readOgg( int fd, long size, MetaBundle &bundle )
+{
+    QByteArray head( QMIN( size, static_cast<long>( MAX_HEAD ) ) );
+
+    if ( !readAt( fd, 0, head ) )
+        return false;
+
+    const uchar *d = reinterpret_cast<const uchar*>( head.data() );
+
+// reassemble the identification and comment packets, which may span several pages
+    QByteArray packets[2];
+    int packet = 0;
+    uint pos = 0;
+
+    while ( packet < 2 && pos + 27 <= head.size() )
+    {
+        if ( memcmp( d + pos, "OggS", 4 ) )
+            return false;
+
+        const uint segments = d[pos + 26];
+        uint data = pos + 27 + segments;
+
+        if ( data > head.size() )
+            break;
+
+        for ( uint i = 0; i < segments && packet < 2; ++i )
+        {
+            const uint lacing = d[pos + 27 + i];
+
+            if ( data + lacing > head.size() )
+                break;
+
+            const uint old = packets[packet].size();
+            packets[packet].resize( old + lacing );
+            memcpy( packets[packet].data() + old, d + data, lacing );
+            data += lacing;
+
+// a lacing value below 255 ends the packet
+            if ( lacing < 255 )
+                ++packet;
+        }
+
+        uint pageSize = 27 + segments;
+
+        for ( uint i = 0; i < segments; ++i )
+            pageSize += d[pos + 27 + i];
+
+        pos += pageSize;
+    }
+
+    const QByteArray &ident = packets[0];
+    const uchar *id = reinterpret_cast<const uchar*>( ident.data() );
+
+    if ( ident.size() < 28 || id[0] != 1 || memcmp( id + 1, "vorbis", 6 ) )
+        return false;
+
+    bundle.m_sampleRate = le32( id + 12 );
+
+    const int nominal = static_cast<int>( le32( id + 20 ) );
+
+    if ( nominal > 0 )
+        bundle.m_bitrate = nominal / 1000;
+
+    const QByteArray &comments = packets[1];
+
+    if ( comments.size() >= 7 && comments[0] == 3 && !memcmp( comments.data() + 1, "vorbis", 6 ) )
+        readVorbisComments( comments, bundle );
+
+    if ( bundle.m_sampleRate <= 0 )
+        return true;
+
+// the granule position of the last page is the number of samples in the stream
+    QByteArray tail( QMIN( size, static_cast<long>( MAX_TAIL ) ) );
+
+    if ( !readAt( fd, size - tail.size(), tail ) )
+        return true;
+
+    const uchar *t = reinterpret_cast<const uchar*>( tail.data() );
+
+    for ( int i = static_cast<int>( tail.size() ) - 14; i >= 0; --i )
+    {
+        if ( memcmp( t + i, "OggS", 4 ) )
+            continue;
+
+        const double samples = le32( t + i + 6 ) + le32( t + i + 10 ) * 4294967296.0;
+        const double length = samples / bundle.m_sampleRate;
+
+        bundle.m_length = static_cast<int>( length );
+
+        if ( bundle.m_bitrate <= 0 && length > 0 )
+            bundle.m_bitrate = static_cast<int>( size * 8.0 / length / 1000 );
+        break;
+    }
+
+    return true;
+}
+
+
+
+void TagReader::readVorbisComments( const QByteArray &packet, MetaBundle &bundle )
+{
+    const uchar *d = reinterpret_cast<const uchar*>( packet.data() );
+    const uint size = packet.size();
+    uint pos = 7;
+
+    if ( pos + 4 > size )
+        return;
+
+    const uint vendor = le32( d + pos );
+    pos += 4;
+
+    if ( vendor > size - pos || pos + vendor + 4 > size )
+        return;
+
+    pos += vendor;
+    const uint count = le32( d + pos );
+    pos += 4;
+
+    for ( uint i = 0; i < count && pos + 4 <= size; ++i )
+    {
+        const uint length = le32( d + pos );
+        pos += 4;
+
+        if ( length > size - pos )
+            break;
+
+        const QString comment = QString::fromUtf8( reinterpret_cast<const char*>( d + pos ), length );
+        pos += length;
+
+        const int equals = comment.find( '=' );
+
+        if ( equals < 1 )
+            continue;
+
+        const QString key = comment.left( equals ).upper();
+        QString *field = 0;
+
+        if ( key == "TITLE" )
+            field = &bundle.m_title;
+        else if ( key == "ARTIST" )
+            field = &bundle.m_artist;
+        else if ( key == "ALBUM" )
+            field = &bundle.m_album;
+        else if ( key == "GENRE" )
+            field = &bundle.m_genre;
+
+// only the first of several values is used
+        if ( field && field->isEmpty() )
+            *field = comment.mid( equals + 1 ).stripWhiteSpace();
+    }
+}
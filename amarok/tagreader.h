@@ -0,0 +1,55 @@
+/***************************************************************************
+                          tagreader.h  -  description
+                             -------------------
+    begin                : Die Mai 6 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <qcstring.h>
+#include <qstring.h>
+
+class MetaBundle;
+class SeekIndex;
+
+/**
+ * Reads tags and stream properties of MP3 (ID3v1/ID3v2 + MPEG header) and
+ * Ogg Vorbis files. Only plain file I/O is used, no KDE classes, so unlike
+ * KFileMetaInfo this can run in any thread. For all other formats read()
+ * returns false and the caller has to fall back to KFileMetaInfo.
+ * readSeekIndex() scans all frames of an MP3 file for a SeekIndex.
+ *@author mark
+ */
+
+class TagReader
+{
+    public:
+        static bool read( const QString &path, MetaBundle &bundle );
+        static bool readSeekIndex( const QString &path, SeekIndex &index, const volatile bool &abort );
+
+    private:
+        static bool readMp3( int fd, long size, MetaBundle &bundle );
+        static bool readOgg( int fd, long size, MetaBundle &bundle );
+        static bool scanMp3( int fd, long size, SeekIndex &index, const volatile bool &abort );
+
+        static long readId3v2( const QByteArray &head, MetaBundle &bundle );
+        static void readId3v1( int fd, long size, MetaBundle &bundle );
+        static QString id3Text( const char *data, uint length );
+        static QString id3Genre( const QString &genre );
+        static void readVorbisComments( const QByteArray &packet, MetaBundle &bundle );
+
+        static bool readAt( int fd, long offset, QByteArray &buffer );
+};
+#endif
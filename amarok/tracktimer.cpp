@@ -0,0 +1,254 @@
+/***************************************************************************
+                          tracktimer.cpp  -  description
+                             -------------------
+    begin                : Son Mai 18 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "tracktimer.h"
+
+#include <qdatetime.h>
+#include <qstring.h>
+#include <qtl.h>
+#include <qvaluevector.h>
+
+#include <kdebug.h>
+
+// track changes kept for the report
+static const uint RECORD_COUNT = 100;
+// of those, how many are listed one by one
+static const uint LISTED_RECORDS = 20;
+// upper bounds of the histogram buckets in ms, the last bucket takes the rest
+static const int BUCKETS[] = { 10, 20, 50, 100, 200, 500, 1000, 2000 };
+static const int BUCKET_COUNT = sizeof( BUCKETS ) / sizeof( BUCKETS[0] );
+
+
+TrackTimer::TrackTimer() :
+m_lastMark( 0 ),
+m_running( false ),
+m_cause( causePlay ),
+m_next( 0 ),
+m_outputLatency( 0 ),
+m_log( false )
+{
+    m_records.reserve( RECORD_COUNT );
+}
+
+
+
+// METHODS -------------------------------------------------------
+
+void TrackTimer::setCause( Cause cause )
+{
+// the first one wins, slotNext() calling slotPlay() doesn't make a double-click a play button press
+    if ( m_cause == causePlay )
+        m_cause = cause;
+}
+
+
+
+void TrackTimer::begin()
+{
+// a change still running never got its track to play, skipped or stopped while loading
+    finish();
+
+    m_current.cause = m_cause;
+    m_cause = causePlay;
+
+    for ( int i = 0; i < phaseCount; ++i )
+        m_current.phases[i] = -1;
+
+    m_current.audible = -1;
+    m_lastMark = 0;
+    m_running = true;
+    m_time.start();
+}
+
+
+
+void TrackTimer::mark( Phase phase )
+{
+    if ( !m_running || m_current.phases[phase] != -1 )
+        return;
+
+    const int now = m_time.elapsed();
+
+    m_current.phases[phase] = now - m_lastMark;
+    m_lastMark = now;
+
+    if ( phase == phaseStart )
+        m_current.audible = now + m_outputLatency;
+
+// the title may come before the track starts, when the length is known early
+    if ( m_current.phases[phaseStart] != -1 && m_current.phases[phaseTitle] != -1 )
+        finish();
+}
+
+
+
+void TrackTimer::finish()
+{
+    if ( !m_running )
+        return;
+
+    m_running = false;
+
+    if ( m_records.count() < RECORD_COUNT )
+        m_records.append( m_current );
+    else
+        m_records[m_next] = m_current;
+
+    m_next = ( m_next + 1 ) % RECORD_COUNT;
+
+    if ( m_log )
+        kdDebug() << "Track change: " << describe( m_current ) << endl;
+}
+
+
+
+QString TrackTimer::report() const
+{
+    const uint count = m_records.count();
+
+    if ( count == 0 )
+        return "No track changes recorded yet.\n";
+
+    QString text;
+    QString line;
+
+    text += QString( "Last %1 track changes, times in ms\n\n" ).arg( count );
+    text += line.sprintf( "%-10s %6s %6s", "", "median", "max" );
+
+    for ( int b = 0; b < BUCKET_COUNT; ++b )
+        text += line.sprintf( " %5s", QString( "<%1" ).arg( BUCKETS[b] ).latin1() );
+
+    text += line.sprintf( " %5s\n", "more" );
+
+// one row per phase, the last one for the time until the track is heard
+    for ( int p = 0; p <= phaseCount; ++p )
+    {
+        QValueVector<int> values;
+        values.reserve( count );
+
+        for ( uint i = 0; i < count; ++i )
+        {
+            const int ms = p < phaseCount ? m_records[i].phases[p] : m_records[i].audible;
+
+            if ( ms >= 0 )
+                values.push_back( ms );
+        }
+
+        const char *name = p < phaseCount ? phaseName( static_cast<Phase>( p ) ) : "audible";
+
+        if ( values.isEmpty() )
+        {
+            text += line.sprintf( "%-10s %6s %6s\n", name, "-", "-" );
+            continue;
+        }
+
+        qHeapSort( values );
+
+        int buckets[ BUCKET_COUNT + 1 ] = { 0 };
+
+        for ( uint i = 0; i < values.count(); ++i )
+        {
+            int b = 0;
+
+            while ( b < BUCKET_COUNT && values[i] >= BUCKETS[b] )
+                ++b;
+
+            ++buckets[b];
+        }
+
+        text += line.sprintf( "%-10s %6d %6d", name, values[ values.count() / 2 ], values.back() );
+
+        for ( int b = 0; b <= BUCKET_COUNT; ++b )
+            text += line.sprintf( " %5d", buckets[b] );
+
+        text += "\n";
+    }
+
+    text += "\nMost recent first:\n";
+
+    for ( uint i = 0; i < count && i < LISTED_RECORDS; ++i )
+        text += describe( m_records[ ( m_next + count - 1 - i ) % count ] ) + "\n";
+
+    return text;
+}
+
+
+
+QString TrackTimer::describe( const Record &record )
+{
+    QString text = causeName( record.cause );
+    text += ":";
+
+    for ( int p = 0; p < phaseCount; ++p )
+    {
+        if ( record.phases[p] >= 0 )
+            text += QString( " %1 %2" ).arg( phaseName( static_cast<Phase>( p ) ) ).arg( record.phases[p] );
+    }
+
+    if ( record.audible >= 0 )
+        text += QString( ", audible after %1 ms" ).arg( record.audible );
+    else
+        text += ", never started";
+
+    return text;
+}
+
+
+
+const char *TrackTimer::causeName( Cause cause )
+{
+    switch ( cause )
+    {
+        case causeDoubleClick:
+            return "double-click";
+        case causeNext:
+            return "next";
+        case causePrevious:
+            return "previous";
+        case causeAuto:
+            return "end of track";
+        case causeRetry:
+            return "skip after error";
+        default:
+            return "play";
+    }
+}
+
+
+
+const char *TrackTimer::phaseName( Phase phase )
+{
+    switch ( phase )
+    {
+        case phaseStop:
+            return "stop";
+        case phaseDisplay:
+            return "display";
+        case phaseCreate:
+            return "create";
+        case phaseConnect:
+            return "connect";
+        case phasePlay:
+            return "play";
+        case phaseStart:
+            return "start";
+        case phaseTitle:
+            return "title";
+        default:
+            return "?";
+    }
+}
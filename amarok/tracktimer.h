@@ -0,0 +1,85 @@
+/***************************************************************************
+                          tracktimer.h  -  description
+                             -------------------
+    begin                : Son Mai 18 2003
+    copyright            : (C) 2003 by Mark Kretschmann
+    email                :
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef TRACKTIMER_H
+#define TRACKTIMER_H
+
+#include <qdatetime.h>
+#include <qstring.h>
+#include <qvaluevector.h>
+
+/**
+ * Times the phases of each track change, from whatever caused it until the
+ * title is shown. begin() starts a record, mark() ends a phase: it gets the
+ * time since the previous mark, and each phase is only marked once. The
+ * record is complete when the track has started and shows its title, or
+ * with finish(); one still running at the next begin() is kept as it is,
+ * a track that never started. The cause is taken by the next begin(), who
+ * sets one without changing tracks after all calls clearCause(). The last
+ * RECORD_COUNT records are kept, report() sums them up in a histogram per
+ * phase.
+ * "Audible" is the time until artsd reports the track playing, plus the
+ * sound server's buffer, which has to play out before the first sample
+ * is heard.
+ *@author mark
+ */
+
+class TrackTimer
+{
+    public:
+        enum Cause { causePlay, causeDoubleClick, causeNext, causePrevious, causeAuto, causeRetry };
+        enum Phase { phaseStop, phaseDisplay, phaseCreate, phaseConnect, phasePlay, phaseStart, phaseTitle, phaseCount };
+
+        TrackTimer();
+
+        void setCause( Cause cause );
+        void clearCause() { m_cause = causePlay; }
+        void begin();
+        void mark( Phase phase );
+        void finish();
+        bool isRunning() const { return m_running; }
+
+        void setOutputLatency( int ms ) { m_outputLatency = ms; }
+        void setLogging( bool log ) { m_log = log; }
+
+        QString report() const;
+
+    private:
+        struct Record
+        {
+            Cause cause;
+            int phases[ phaseCount ];       // ms, -1 if the phase wasn't marked
+            int audible;                    // ms, -1 if the track never started
+        };
+
+        static const char *causeName( Cause cause );
+        static const char *phaseName( Phase phase );
+        static QString describe( const Record &record );
+
+// ATTRIBUTES ------
+        QTime m_time;
+        int m_lastMark;                     // ms since begin()
+        bool m_running;
+        Cause m_cause;                      // of the next begin()
+        Record m_current;
+
+        QValueVector<Record> m_records;     // ring buffer, m_next is the oldest once it's full
+        uint m_next;
+        int m_outputLatency;                // ms
+        bool m_log;
+};
+#endif